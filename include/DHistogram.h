@@ -0,0 +1,274 @@
+#ifndef _DHISTOGRAM_HEADER_
+#define _DHISTOGRAM_HEADER_
+
+#include "..\include\DUtility.h"
+#include "..\include\DLogger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace DUtility {
+
+	///@brief Bucket layout of the histograms (log-linear, as HdrHistogram).
+	///
+	///Values below 2^bits have a bucket each. Above, each power of 2 is split into 2^(bits-1)
+	///buckets, so the values of a bucket are within 2^-(bits-1) of each other (1.6% for 7 bits).
+	///All of uint64_t is covered by (66 - bits) * 2^(bits-1) buckets (3776 for 7 bits).
+	class DU_DLL_API DHistogramLayout {
+	public:
+		explicit DHistogramLayout(unsigned int bits = 7) : bits(bits < 2 ? 2 : (bits > 16 ? 16 : bits)) {}
+
+		size_t bucket_count() const {
+			return static_cast<size_t>(66 - bits) << (bits - 1);
+		}
+
+		size_t bucket_of(uint64_t value) const {
+			if (value < (uint64_t(1) << bits))
+				return static_cast<size_t>(value);
+			unsigned int shift = msb(value) - (bits - 1);
+			return (static_cast<size_t>(shift + 1) << (bits - 1)) + static_cast<size_t>((value >> shift) - (uint64_t(1) << (bits - 1)));
+		}
+
+		///Highest value of the bucket
+		uint64_t bucket_max(size_t bucket) const {
+			size_t half = size_t(1) << (bits - 1);
+			if (bucket < 2 * half)
+				return bucket;
+			unsigned int shift = static_cast<unsigned int>(bucket / half) - 1;
+			uint64_t top = (bucket % half) + half;
+			return ((top + 1) << shift) - 1;
+		}
+
+		unsigned int bits;
+
+	private:
+		///index of the highest bit set (value > 0)
+		static unsigned int msb(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return static_cast<unsigned int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+			return 63 - static_cast<unsigned int>(__builtin_clzll(value));
+#else
+			unsigned int n = 0;
+			while (value >>= 1)
+				n++;
+			return n;
+#endif
+		}
+	};
+
+	///@brief Counts of a histogram at some point, mergeable with other snapshots of the same layout.
+	struct DU_DLL_API DHistogramSnapshot {
+		explicit DHistogramSnapshot(const DHistogramLayout &layout = DHistogramLayout()) : layout(layout), counts(layout.bucket_count(), 0) {}
+
+		DHistogramLayout layout;
+		std::vector<uint64_t> counts;
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t min = UINT64_MAX;
+		uint64_t max = 0;
+
+		///@brief Add the counts of the other snapshot. Throws if the layouts differ.
+		void merge(const DHistogramSnapshot &other) {
+			if (other.layout.bits != layout.bits)
+				throw std::runtime_error("Histograms of different layouts can't be merged!");
+			for (size_t i = 0; i < counts.size(); i++)
+				counts[i] += other.counts[i];
+			count += other.count;
+			sum += other.sum;
+			min = other.min < min ? other.min : min;
+			max = other.max > max ? other.max : max;
+		}
+
+		///@brief The value below which p percent of the values are (the highest value of its
+		///       bucket, at most max). 0 if empty.
+		uint64_t percentile(double p) const {
+			if (count == 0)
+				return 0;
+			uint64_t rank = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+			rank = rank < 1 ? 1 : (rank > count ? count : rank);
+			uint64_t seen = 0;
+			for (size_t i = 0; i < counts.size(); i++) {
+				seen += counts[i];
+				if (seen >= rank) {
+					uint64_t value = layout.bucket_max(i);
+					return value < max ? value : max;
+				}
+			}
+			return max;
+		}
+
+		double mean() const {
+			return count != 0 ? static_cast<double>(sum) / count : 0;
+		}
+	};
+
+	///@brief Histogram of uint64_t values (e.g. latencies in ns), in fixed memory.
+	///
+	///record() is lock-free (an atomic add on the bucket, and on the count and sum), from any
+	///number of threads. snapshot() copies the counts, for the percentile queries.
+	///
+	///	DHistogram latencies;
+	///	DTimer timer;
+	///	timer.start();
+	///	...
+	///	timer.stop(latencies);                  // records the interval in ns
+	///	auto s = latencies.snapshot();
+	///	s.percentile(99.9);
+	class DU_DLL_API DHistogram {
+	public:
+		explicit DHistogram(unsigned int bits = 7) : layout(bits), counts(new std::atomic<uint64_t>[layout.bucket_count()]) {
+			for (size_t i = 0; i < layout.bucket_count(); i++)
+				counts[i].store(0, std::memory_order_relaxed);
+		}
+
+		DHistogram(const DHistogram &) = delete;
+		DHistogram &operator=(const DHistogram &) = delete;
+
+		void record(uint64_t value, uint64_t times = 1) {
+			counts[layout.bucket_of(value)].fetch_add(times, std::memory_order_relaxed);
+			count.fetch_add(times, std::memory_order_relaxed);
+			sum.fetch_add(value * times, std::memory_order_relaxed);
+			uint64_t current = min.load(std::memory_order_relaxed);
+			while (value < current && !min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+			}
+			current = max.load(std::memory_order_relaxed);
+			while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+			}
+		}
+
+		///@brief Record a duration as ns.
+		void record_seconds(double seconds) {
+			record(seconds > 0 ? static_cast<uint64_t>(seconds * 1e9 + 0.5) : 0);
+		}
+
+		///@brief Copy of the counts (the values recorded meanwhile may be partly in it).
+		DHistogramSnapshot snapshot() const {
+			DHistogramSnapshot s(layout);
+			for (size_t i = 0; i < s.counts.size(); i++)
+				s.counts[i] = counts[i].load(std::memory_order_relaxed);
+			s.count = count.load(std::memory_order_relaxed);
+			s.sum = sum.load(std::memory_order_relaxed);
+			s.min = min.load(std::memory_order_relaxed);
+			s.max = max.load(std::memory_order_relaxed);
+			return s;
+		}
+
+		///@brief The counts since the previous reset, and start again from zero (per interval
+		///       reports). No value is lost, but one recorded meanwhile may have its bucket and
+		///       its count in different intervals.
+		DHistogramSnapshot snapshot_and_reset() {
+			DHistogramSnapshot s(layout);
+			for (size_t i = 0; i < s.counts.size(); i++)
+				s.counts[i] = counts[i].exchange(0, std::memory_order_relaxed);
+			s.count = count.exchange(0, std::memory_order_relaxed);
+			s.sum = sum.exchange(0, std::memory_order_relaxed);
+			s.min = min.exchange(UINT64_MAX, std::memory_order_relaxed);
+			s.max = max.exchange(0, std::memory_order_relaxed);
+			return s;
+		}
+
+		void reset() {
+			snapshot_and_reset();
+		}
+
+		const DHistogramLayout layout;
+
+	private:
+		std::unique_ptr<std::atomic<uint64_t>[]> counts;
+		std::atomic<uint64_t> count{0};
+		std::atomic<uint64_t> sum{0};
+		std::atomic<uint64_t> min{UINT64_MAX};
+		std::atomic<uint64_t> max{0};
+	};
+
+	///@brief Logs the histograms added to it every period, through a DLog (at info level):
+	///
+	///	request latency : count 1000 mean 12.5us p50 11.0us p90 20.1us p99 40.3us p99.9 80.0us max 95.2us
+	///
+	///The values are taken as ns. The histograms are reset at each report unless added with
+	///reset = false (cumulative). The DLog and the histograms must outlive the reporter.
+	class DU_DLL_API DHistogramReporter {
+	public:
+		DHistogramReporter(DLog &log, std::chrono::milliseconds period) : log(log), period(period) {
+			worker = std::thread([this]() { run(); });
+		}
+
+		~DHistogramReporter() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopped = true;
+			}
+			cv.notify_one();
+			worker.join();
+		}
+
+		DHistogramReporter(const DHistogramReporter &) = delete;
+		DHistogramReporter &operator=(const DHistogramReporter &) = delete;
+
+		void add(const std::string &name, DHistogram &histogram, bool reset = true) {
+			std::lock_guard<std::mutex> lock(mutex);
+			entries.push_back(entry{ name, &histogram, reset });
+		}
+
+		///@brief Log the histograms now.
+		void report() {
+			std::lock_guard<std::mutex> lock(mutex);
+			report_locked();
+		}
+
+		///@brief One line of the report.
+		static std::string format(const std::string &name, const DHistogramSnapshot &s) {
+			std::ostringstream out;
+			out << std::fixed << std::setprecision(1) << name << " : count " << s.count
+				<< " mean " << s.mean() / 1000 << "us"
+				<< " p50 " << s.percentile(50) / 1000.0 << "us"
+				<< " p90 " << s.percentile(90) / 1000.0 << "us"
+				<< " p99 " << s.percentile(99) / 1000.0 << "us"
+				<< " p99.9 " << s.percentile(99.9) / 1000.0 << "us"
+				<< " max " << s.max / 1000.0 << "us";
+			return out.str();
+		}
+
+	private:
+		struct entry {
+			std::string name;
+			DHistogram *histogram;
+			bool reset;
+		};
+
+		void run() {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!cv.wait_for(lock, period, [this]() { return stopped; }))
+				report_locked();
+		}
+
+		void report_locked() {
+			for (auto &e : entries) {
+				DHistogramSnapshot s = e.reset ? e.histogram->snapshot_and_reset() : e.histogram->snapshot();
+				log.info(format(e.name, s));
+			}
+		}
+
+		DLog &log;
+		std::chrono::milliseconds period;
+		std::vector<entry> entries;
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stopped = false;
+		std::thread worker;
+	};
+}
+
+#endif// 2026/10/17
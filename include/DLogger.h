@@ -4,6 +4,9 @@
 #include "../include/spdlog/spdlog.h"
 #include "../include/spdlog/sinks/stdout_color_sinks.h"
 #include "../include/spdlog/sinks/basic_file_sink.h"
+#include "../include/spdlog/sinks/rotating_file_sink.h"
+#include "../include/spdlog/sinks/daily_file_sink.h"
+#include "../include/spdlog/async.h"
 #include "../include/DUtility.h"
 
 /*!
@@ -20,28 +23,85 @@
 using namespace spdlog;
 using namespace sinks;
 
+///@brief source location of a log call, a static of the call site (see DLOG_INFO)
+struct DLogCallSite
+{
+	const char *file;
+	const char *function;
+	unsigned int line;
+};
+
+///@brief settings of the asynchronous loggers (see DLog::init_async): the messages are queued
+///       and written by the backend threads, so the log calls do no I/O
+struct DLogAsyncOptions
+{
+	DLogAsyncOptions(size_t _queue_size = 8192, size_t _thread_count = 1,
+		spdlog::async_overflow_policy _overflow_policy = spdlog::async_overflow_policy::block)
+		: queue_size(_queue_size), thread_count(_thread_count), overflow_policy(_overflow_policy) {
+	}
+	size_t queue_size;		///< max messages in the queue
+	size_t thread_count;	///< backend threads
+	spdlog::async_overflow_policy overflow_policy;	///< when the queue is full: block, overrun_oldest or discard_new
+};
+
 	#ifdef NOLOG
 		class DU_DLL_API DLog
 		{
 			public:
 				DLog() {
-					std::cout << " NoLog define is used , no any log will be output" << std::endl;
 				}
 				~DLog() {}
 			public:
-				void init(std::string _logger_name) {
+				void init(const std::string &_logger_name) {
+				}
+				void init(const std::string &_logger_name, const std::string &_log_file_name) {
+				}
+				///@brief the sink lists are not templates, so that braced lists still compile:
+				///       init("app", { sink1, sink2 })
+				void init(const std::string &_logger_name, const std::vector<spdlog::sink_ptr> &_sinks) {
+				}
+				template<typename... Args>
+				void init(const std::string &_logger_name, const Args &...) {
+				}
+				void init_async(const std::string &_logger_name, const std::vector<spdlog::sink_ptr> &_sinks, const DLogAsyncOptions &_options = DLogAsyncOptions()) {
+				}
+				template<typename... Args>
+				void init_async(const Args &...) {
+				}
+				template<typename... Args>
+				void init_rotating(const Args &...) {
+				}
+				template<typename... Args>
+				void init_daily(const Args &...) {
+				}
+				void flush() {
+				}
+				///@brief the log functions take any arguments and do nothing (string literals are not
+				///       even converted to std::string). the DLOG_* macros skip the arguments too
+				template<typename... Args>
+				void warn(const Args &...) {
+				}
+				template<typename... Args>
+				void info(const Args &...) {
+				}
+				template<typename... Args>
+				void critical(const Args &...) {
 				}
-				void init(std::string _logger_name, std::string _log_file_name) {
+				template<typename... Args>
+				void debug(const Args &...) {
 				}
-				void warn(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				template<typename... Args>
+				void error(const Args &...) {
 				}
-				void info(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				template<typename... Args>
+				void log(const Args &...) {
 				}
-				void critical(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				bool should_log(spdlog::level::level_enum) const {
+					return false;
 				}
-				void debug(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				void log_suppressed(spdlog::level::level_enum, size_t) {
 				}
-				void error(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				void report_suppressed_on_flush(spdlog::details::rate_limiter &, spdlog::level::level_enum) {
 				}
 		};
 	#else
@@ -58,45 +118,249 @@ using namespace sinks;
 				void init(std::string _logger_name,std::string _log_file_name) {
 					m_log_handle = spdlog::basic_logger_mt(_logger_name, _log_file_name);
 				}
+				///@brief several sinks at once, e.g. console and file:
+				///       init("app", { std::make_shared<spdlog::sinks::stdout_color_sink_mt>(),
+				///                     std::make_shared<spdlog::sinks::basic_file_sink_mt>("app.log") });
+				void init(const std::string &_logger_name, const std::vector<spdlog::sink_ptr> &_sinks) {
+					m_log_handle = std::make_shared<spdlog::logger>(_logger_name, _sinks.begin(), _sinks.end());
+					spdlog::details::registry::instance().register_and_init(m_log_handle);
+				}
+				///@brief console, asynchronous
+				void init_async(const std::string &_logger_name, const DLogAsyncOptions &_options = DLogAsyncOptions()) {
+					init_async(_logger_name, { std::make_shared<spdlog::sinks::stdout_color_sink_mt>() }, _options);
+				}
+				///@brief file, asynchronous
+				void init_async(const std::string &_logger_name, const std::string &_log_file_name, const DLogAsyncOptions &_options = DLogAsyncOptions()) {
+					init_async(_logger_name, { std::make_shared<spdlog::sinks::basic_file_sink_mt>(_log_file_name) }, _options);
+				}
+				///@brief several sinks at once, asynchronous
+				///       the backend threads and queue are owned by this DLog
+				void init_async(const std::string &_logger_name, const std::vector<spdlog::sink_ptr> &_sinks, const DLogAsyncOptions &_options = DLogAsyncOptions()) {
+					m_thread_pool = std::make_shared<spdlog::details::thread_pool>(_options.queue_size, _options.thread_count);
+					m_log_handle = std::make_shared<spdlog::async_logger>(_logger_name, _sinks.begin(), _sinks.end(), m_thread_pool, _options.overflow_policy);
+					spdlog::details::registry::instance().register_and_init(m_log_handle);
+				}
+				///@brief file rotated when it reaches _max_size bytes, keeping _max_files files
+				///       asynchronous if _options are given
+				void init_rotating(const std::string &_logger_name, const std::string &_log_file_name, size_t _max_size, size_t _max_files) {
+					init(_logger_name, { std::make_shared<spdlog::sinks::rotating_file_sink_mt>(_log_file_name, _max_size, _max_files) });
+				}
+				void init_rotating(const std::string &_logger_name, const std::string &_log_file_name, size_t _max_size, size_t _max_files, const DLogAsyncOptions &_options) {
+					init_async(_logger_name, { std::make_shared<spdlog::sinks::rotating_file_sink_mt>(_log_file_name, _max_size, _max_files) }, _options);
+				}
+				///@brief new file every day at _hour:_minute
+				///       asynchronous if _options are given
+				void init_daily(const std::string &_logger_name, const std::string &_log_file_name, int _hour = 0, int _minute = 0) {
+					init(_logger_name, { std::make_shared<spdlog::sinks::daily_file_sink_mt>(_log_file_name, _hour, _minute) });
+				}
+				void init_daily(const std::string &_logger_name, const std::string &_log_file_name, int _hour, int _minute, const DLogAsyncOptions &_options) {
+					init_async(_logger_name, { std::make_shared<spdlog::sinks::daily_file_sink_mt>(_log_file_name, _hour, _minute) }, _options);
+				}
+				///@brief flush the sinks (queued behind the pending messages if asynchronous)
+				void flush() {
+					if (m_log_handle)
+						m_log_handle->flush();
+				}
 				///@brief warn 
-				void warn(std::string _msg,std::string _function_name = "",unsigned int _line_number = 0) {
+				void warn(const std::string &_msg, const std::string &_function_name = "", unsigned int _line_number = 0) {
 					if(_line_number)
 						m_log_handle->warn("{0} in fuction : {1} at line :{2:d}", _msg, _function_name, _line_number);
 					else
 						m_log_handle->warn("{0}", _msg);
 				}
 				///@brief info 
-				void info(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				void info(const std::string &_msg, const std::string &_function_name = "", unsigned int _line_number = 0) {
 					if (_line_number)
 						m_log_handle->info("{0} in fuction : {1} at line :{2:d}", _msg, _function_name, _line_number);
 					else
 						m_log_handle->info("{0}", _msg);
 				}
 				///@brief critical
-				void critical(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				void critical(const std::string &_msg, const std::string &_function_name = "", unsigned int _line_number = 0) {
 					if (_line_number)
 						m_log_handle->critical("{0} in fuction : {1} at line :{2:d}", _msg, _function_name, _line_number);
 					else
 						m_log_handle->critical("{0}", _msg);
 				}
 				///@brief debug 
-				void debug(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				void debug(const std::string &_msg, const std::string &_function_name = "", unsigned int _line_number = 0) {
 					if (_line_number)
 						m_log_handle->debug("{0} in fuction : {1} at line :{2:d}", _msg, _function_name, _line_number);
 					else
 						m_log_handle->debug("{0}", _msg);
 				}
 				///@brief error 
-				void error(std::string _msg, std::string _function_name = "", unsigned int _line_number = 0) {
+				void error(const std::string &_msg, const std::string &_function_name = "", unsigned int _line_number = 0) {
 					if (_line_number)
 						m_log_handle->error("{0} in fuction : {1} at line :{2:d}", _msg, _function_name, _line_number);
 					else
 						m_log_handle->error("{0}", _msg);
 				}
+				///@brief true if a message of the level would be output (see DLOG_RATE_LIMITED)
+				bool should_log(spdlog::level::level_enum _level) const {
+					return m_log_handle && m_log_handle->should_log(_level);
+				}
+				///@brief log at the given level
+				void log(spdlog::level::level_enum _level, const std::string &_msg, const std::string &_function_name = "", unsigned int _line_number = 0) {
+					if (_line_number)
+						m_log_handle->log(_level, "{0} in fuction : {1} at line :{2:d}", _msg, _function_name, _line_number);
+					else
+						m_log_handle->log(_level, "{0}", _msg);
+				}
+				///@brief log the fmt formatted arguments at the given level, followed by the call site
+				///       (function, line and file). nothing is formatted if the level is disabled,
+				///       and the message and the call site are formatted once, on the stack (no
+				///       allocation up to 500 chars), then passed to the logger as is
+				template<typename... Args>
+				void log(const DLogCallSite &_site, spdlog::level::level_enum _level, const char *_fmt, const Args &... _args) {
+					if (!should_log(_level))
+						return;
+					fmt::memory_buffer msg;
+					fmt::format_to(msg, _fmt, _args...);
+					fmt::format_to(msg, " in fuction : {} at line :{:d} in file : {}", _site.function, _site.line, _site.file);
+					m_log_handle->log(_level, fmt::string_view(msg.data(), msg.size()));
+				}
+				///@brief the same at each level
+				template<typename... Args>
+				void debug(const DLogCallSite &_site, const char *_fmt, const Args &... _args) {
+					log(_site, spdlog::level::debug, _fmt, _args...);
+				}
+				template<typename... Args>
+				void info(const DLogCallSite &_site, const char *_fmt, const Args &... _args) {
+					log(_site, spdlog::level::info, _fmt, _args...);
+				}
+				template<typename... Args>
+				void warn(const DLogCallSite &_site, const char *_fmt, const Args &... _args) {
+					log(_site, spdlog::level::warn, _fmt, _args...);
+				}
+				template<typename... Args>
+				void error(const DLogCallSite &_site, const char *_fmt, const Args &... _args) {
+					log(_site, spdlog::level::err, _fmt, _args...);
+				}
+				template<typename... Args>
+				void critical(const DLogCallSite &_site, const char *_fmt, const Args &... _args) {
+					log(_site, spdlog::level::critical, _fmt, _args...);
+				}
+				///@brief summary of the messages suppressed by a call site limiter
+				void log_suppressed(spdlog::level::level_enum _level, size_t _count) {
+					m_log_handle->log(_level, "suppressed {} similar messages", _count);
+				}
+				///@brief have the summary of the limiter logged by the next flush(), unless the call
+				///       site lets a message through before (see DLOG_RATE_LIMITED)
+				void report_suppressed_on_flush(spdlog::details::rate_limiter &_limiter, spdlog::level::level_enum _level) {
+					m_log_handle->report_suppressed_on_flush(_limiter, _level);
+				}
 			protected:
 				//spdlog handle
 				std::shared_ptr<logger> m_log_handle;
+				//backend of the asynchronous logger (destroyed first: writes the queued messages)
+				std::shared_ptr<spdlog::details::thread_pool> m_thread_pool;
 		};
 	#endif
 
+/*!
+* \brief  compile time minimum level of the DLOG_* macros (same values as spdlog::level)
+*		   the calls below it compile to nothing, their arguments are not evaluated
+*		   all levels by default, none if NOLOG is defined
+* \note   e.g. /D DLOG_ACTIVE_LEVEL=DLOG_LEVEL_WARN in release builds
+*/
+#define DLOG_LEVEL_TRACE 0
+#define DLOG_LEVEL_DEBUG 1
+#define DLOG_LEVEL_INFO 2
+#define DLOG_LEVEL_WARN 3
+#define DLOG_LEVEL_ERROR 4
+#define DLOG_LEVEL_CRITICAL 5
+#define DLOG_LEVEL_OFF 6
+
+#ifndef DLOG_ACTIVE_LEVEL
+	#ifdef NOLOG
+		#define DLOG_ACTIVE_LEVEL DLOG_LEVEL_OFF
+	#else
+		#define DLOG_ACTIVE_LEVEL DLOG_LEVEL_TRACE
+	#endif
+#endif
+
+/*!
+* \brief  log macros with the call site (file, function and line) recorded in a static
+*		   the arguments are evaluated and formatted only if the level is enabled, at compile
+*		   time (DLOG_ACTIVE_LEVEL) and at run time
+* \note   e.g. DLOG_INFO(m_log, "loaded {} items from {}", count, path);
+*/
+#define DLOG_LOG(dlog, level, ...) \
+	do { \
+		if (static_cast<int>(level) >= DLOG_ACTIVE_LEVEL && (dlog).should_log(level)) { \
+			static const DLogCallSite dlog_call_site_ = { __FILE__, __func__, __LINE__ }; \
+			(dlog).log(dlog_call_site_, level, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#if DLOG_ACTIVE_LEVEL <= DLOG_LEVEL_DEBUG
+	#define DLOG_DEBUG(dlog, ...) DLOG_LOG(dlog, spdlog::level::debug, __VA_ARGS__)
+#else
+	#define DLOG_DEBUG(dlog, ...) (void)0
+#endif
+
+#if DLOG_ACTIVE_LEVEL <= DLOG_LEVEL_INFO
+	#define DLOG_INFO(dlog, ...) DLOG_LOG(dlog, spdlog::level::info, __VA_ARGS__)
+#else
+	#define DLOG_INFO(dlog, ...) (void)0
+#endif
+
+#if DLOG_ACTIVE_LEVEL <= DLOG_LEVEL_WARN
+	#define DLOG_WARN(dlog, ...) DLOG_LOG(dlog, spdlog::level::warn, __VA_ARGS__)
+#else
+	#define DLOG_WARN(dlog, ...) (void)0
+#endif
+
+#if DLOG_ACTIVE_LEVEL <= DLOG_LEVEL_ERROR
+	#define DLOG_ERROR(dlog, ...) DLOG_LOG(dlog, spdlog::level::err, __VA_ARGS__)
+#else
+	#define DLOG_ERROR(dlog, ...) (void)0
+#endif
+
+#if DLOG_ACTIVE_LEVEL <= DLOG_LEVEL_CRITICAL
+	#define DLOG_CRITICAL(dlog, ...) DLOG_LOG(dlog, spdlog::level::critical, __VA_ARGS__)
+#else
+	#define DLOG_CRITICAL(dlog, ...) (void)0
+#endif
+
+/*!
+* \brief  per call site rate limiting and sampling of DLog messages
+*		   (see spdlog/details/log_limiter.h)
+*		   the level and the limiter are checked before the message is built,
+*		   so the suppressed calls cost an atomic or two
+*		   DLOG_RATE_LIMITED(dlog, level, rate_per_sec, burst, msg) : at most rate_per_sec messages
+*		   per second, in bursts of up to burst; the next message let through is preceded by
+*		   "suppressed N similar messages", or the next flush() logs it if the call site stops
+*		   firing (spdlog::flush_every(...) bounds how late it comes)
+*		   DLOG_SAMPLED(dlog, level, n, msg) : the first of every n messages
+* \note   e.g. DLOG_RATE_LIMITED(m_log, spdlog::level::err, 10, 100, "read failed : " + path);
+*/
+#define DLOG_RATE_LIMITED(dlog, level, rate_per_sec, burst, msg) \
+	do { \
+		if (static_cast<int>(level) >= DLOG_ACTIVE_LEVEL) { \
+			static spdlog::details::rate_limiter dlog_rate_limiter_(rate_per_sec, burst); \
+			size_t dlog_suppressed_ = 0; \
+			if ((dlog).should_log(level)) { \
+				if (dlog_rate_limiter_.allow(dlog_suppressed_)) { \
+					if (dlog_suppressed_) \
+						(dlog).log_suppressed(level, dlog_suppressed_); \
+					(dlog).log(level, msg, __func__, __LINE__); \
+				} \
+				else if (dlog_suppressed_ == 1) \
+					(dlog).report_suppressed_on_flush(dlog_rate_limiter_, level); \
+			} \
+		} \
+	} while (0)
+
+#define DLOG_SAMPLED(dlog, level, n, msg) \
+	do { \
+		if (static_cast<int>(level) >= DLOG_ACTIVE_LEVEL) { \
+			static spdlog::details::log_sampler dlog_log_sampler_(n); \
+			size_t dlog_suppressed_ = 0; \
+			if ((dlog).should_log(level) && dlog_log_sampler_.allow(dlog_suppressed_)) \
+				(dlog).log(level, msg, __func__, __LINE__); \
+		} \
+	} while (0)
+
 #endif// 2018/10/25
\ No newline at end of file
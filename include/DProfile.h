@@ -0,0 +1,285 @@
+#ifndef _DPROFILE_HEADER_
+#define _DPROFILE_HEADER_
+
+#include "..\include\DUtility.h"
+#include "..\include\singleton.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+	#define DPROFILE_RDTSC() __rdtsc()
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#include <x86intrin.h>
+	#define DPROFILE_RDTSC() __rdtsc()
+#endif
+
+namespace DUtility {
+
+	///@brief A profiling zone: the static descriptor of a DPROFILE_SCOPE.
+	struct DProfileZone {
+		const char *name;
+		const char *file;
+		unsigned int line;
+	};
+
+	///@brief Node of the call tree of a thread: a zone entered from a given path of zones.
+	///
+	///The counters are written by the owner thread only (plain load + store), and read by the
+	///reports from the other threads.
+	struct DProfileNode {
+		explicit DProfileNode(const DProfileZone *zone_, DProfileNode *parent_) : zone(zone_), parent(parent_) {}
+
+		const DProfileZone *zone;                 ///< nullptr for the root
+		DProfileNode *parent;
+		DProfileNode *last_child = nullptr;       ///< last child entered (checked first)
+		std::vector<DProfileNode *> children;     ///< added under the mutex of the thread tree
+		std::atomic<uint64_t> count{0};           ///< times entered
+		std::atomic<uint64_t> ticks{0};           ///< inclusive time
+
+		void add(uint64_t elapsed) {
+			count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			ticks.store(ticks.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+		}
+	};
+
+	///@brief The call tree of a thread, and the zone it is in.
+	class DProfileThread {
+	public:
+		DProfileThread() : root(nullptr, nullptr), current(&root) {}
+
+		///Enter the zone from the current one. Return its node
+		DProfileNode *enter(const DProfileZone *zone) {
+			DProfileNode *parent = current;
+			DProfileNode *node = parent->last_child;
+			if (node == nullptr || node->zone != zone)
+				node = child(parent, zone);
+			parent->last_child = node;
+			current = node;
+			return node;
+		}
+
+		DProfileNode root;
+		DProfileNode *current;
+		std::mutex mutex;   ///< taken to add nodes, and by the reports
+
+	private:
+		DProfileNode *child(DProfileNode *parent, const DProfileZone *zone) {
+			for (auto *node : parent->children) {
+				if (node->zone == zone)
+					return node;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			nodes.emplace_back(new DProfileNode(zone, parent));
+			parent->children.push_back(nodes.back().get());
+			return nodes.back().get();
+		}
+
+		std::vector<std::unique_ptr<DProfileNode> > nodes;
+	};
+
+	///@brief Collects the call trees of the threads (see DPROFILE_SCOPE).
+	///
+	///Each thread records its zones in its own tree, without locking. report() merges the trees
+	///of all the threads (the running ones, and the ones merged when their thread exited) by
+	///zone path, and prints the calls, inclusive and exclusive time of each path.
+	///The times are cpu ticks (rdtsc on x86, steady_clock elsewhere), converted to ms with the
+	///rate measured since the first zone.
+	///Header only, not exported: the thread trees are thread_local.
+	class DProfiler : public OnceSingleton<DProfiler> {
+		MAKE_ONCESINGLETON(DProfiler)
+	public:
+		///@brief Current ticks.
+		static uint64_t ticks() {
+#if defined(DPROFILE_RDTSC)
+			return DPROFILE_RDTSC();
+#else
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+		}
+
+		///@brief The tree of the calling thread (created by its first zone).
+		static DProfileThread &thread_tree();
+
+		///@brief The merged report of all threads, as text.
+		std::string report() {
+			DTotals totals(nullptr);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				totals.merge(retired);
+				for (auto *thread : threads) {
+					std::lock_guard<std::mutex> thread_lock(thread->mutex);
+					totals.merge(thread->root);
+				}
+			}
+			double ms_per_tick = this->ms_per_tick();
+			std::ostringstream out;
+			out << std::left << std::setw(48) << "zone" << std::right << std::setw(12) << "calls"
+				<< std::setw(14) << "incl(ms)" << std::setw(14) << "excl(ms)" << "\n";
+			print_children(out, totals, 0, ms_per_tick);
+			return out.str();
+		}
+
+		///@brief Write the report to the stream.
+		void report(std::ostream &out) {
+			out << report() << std::flush;
+		}
+
+		///@brief Merge the tree of an exiting thread in the totals, and drop it.
+		void retire(DProfileThread *thread) {
+			std::lock_guard<std::mutex> lock(mutex);
+			{
+				std::lock_guard<std::mutex> thread_lock(thread->mutex);
+				retired.merge(thread->root);
+			}
+			threads.erase(std::remove(threads.begin(), threads.end(), thread), threads.end());
+			delete thread;
+		}
+
+		DProfileThread *add_thread() {
+			DProfileThread *thread = new DProfileThread;
+			std::lock_guard<std::mutex> lock(mutex);
+			threads.push_back(thread);
+			return thread;
+		}
+
+	private:
+		///merged counters of a zone path
+		struct DTotals {
+			explicit DTotals(const DProfileZone *zone_) : zone(zone_) {}
+
+			const DProfileZone *zone;
+			uint64_t count = 0;
+			uint64_t ticks = 0;
+			std::vector<DTotals> children;
+
+			///the zones of the same name (at different call sites) are merged
+			static bool same_name(const DProfileZone *a, const DProfileZone *b) {
+				return a == b || std::strcmp(a->name, b->name) == 0;
+			}
+
+			void merge(const DProfileNode &node) {
+				for (auto *child : node.children) {
+					DTotals *totals = nullptr;
+					for (auto &c : children) {
+						if (same_name(c.zone, child->zone)) {
+							totals = &c;
+							break;
+						}
+					}
+					if (totals == nullptr) {
+						children.emplace_back(child->zone);
+						totals = &children.back();
+					}
+					totals->count += child->count.load(std::memory_order_relaxed);
+					totals->ticks += child->ticks.load(std::memory_order_relaxed);
+					totals->merge(*child);
+				}
+			}
+
+			void merge(const DTotals &other) {
+				for (auto &child : other.children) {
+					auto it = std::find_if(children.begin(), children.end(), [&](const DTotals &c) { return same_name(c.zone, child.zone); });
+					if (it == children.end()) {
+						children.push_back(child);
+						continue;
+					}
+					it->count += child.count;
+					it->ticks += child.ticks;
+					it->merge(child);
+				}
+			}
+		};
+
+		static void print(std::ostream &out, const DTotals &totals, int depth, double ms_per_tick) {
+			uint64_t children_ticks = 0;
+			for (auto &child : totals.children)
+				children_ticks += child.ticks;
+			uint64_t exclusive = totals.ticks > children_ticks ? totals.ticks - children_ticks : 0;
+			std::string name = std::string(depth * 2, ' ') + totals.zone->name;
+			out << std::left << std::setw(48) << name << std::right << std::setw(12) << totals.count
+				<< std::fixed << std::setprecision(3) << std::setw(14) << totals.ticks * ms_per_tick
+				<< std::setw(14) << exclusive * ms_per_tick << "\n";
+			print_children(out, totals, depth + 1, ms_per_tick);
+		}
+
+		///the children of the path, the most expensive first
+		static void print_children(std::ostream &out, const DTotals &totals, int depth, double ms_per_tick) {
+			std::vector<const DTotals *> sorted;
+			for (auto &child : totals.children)
+				sorted.push_back(&child);
+			std::sort(sorted.begin(), sorted.end(), [](const DTotals *a, const DTotals *b) { return a->ticks > b->ticks; });
+			for (auto *child : sorted)
+				print(out, *child, depth, ms_per_tick);
+		}
+
+		double ms_per_tick() const {
+			uint64_t elapsed_ticks = ticks() - start_ticks;
+			double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+			return elapsed_ticks != 0 ? elapsed_ms / elapsed_ticks : 0;
+		}
+
+		std::mutex mutex;
+		std::vector<DProfileThread *> threads;   ///< trees of the running threads
+		DTotals retired{nullptr};                 ///< trees of the exited threads
+		const uint64_t start_ticks = ticks();
+		const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	};
+
+	///@brief Owns the tree of a thread, merged in the profiler when the thread exits.
+	struct DProfileThreadHolder {
+		DProfileThreadHolder() : thread(DProfiler::get_instance().add_thread()) {}
+		~DProfileThreadHolder() { DProfiler::get_instance().retire(thread); }
+		DProfileThread *thread;
+	};
+
+	inline DProfileThread &DProfiler::thread_tree() {
+		static thread_local DProfileThreadHolder holder;
+		return *holder.thread;
+	}
+
+	///@brief Times the enclosing scope as a zone of the calling thread's tree.
+	class DProfileScope {
+	public:
+		explicit DProfileScope(const DProfileZone *zone) : thread(DProfiler::thread_tree()), node(thread.enter(zone)), start(DProfiler::ticks()) {}
+		~DProfileScope() {
+			node->add(DProfiler::ticks() - start);
+			thread.current = node->parent;
+		}
+		DProfileScope(const DProfileScope &) = delete;
+		DProfileScope &operator=(const DProfileScope &) = delete;
+
+	private:
+		DProfileThread &thread;
+		DProfileNode *node;
+		uint64_t start;
+	};
+}
+
+///@brief Profile the enclosing scope as the zone name (a string literal):
+///
+///	void parse() {
+///		DPROFILE_SCOPE("parse");
+///		...
+///	}
+///	std::cout << DUtility::DProfiler::get_instance().report();
+///
+///Defining the global `NOPROFILE` disables the zones.
+#define DPROFILE_CONCAT_(a, b) a##b
+#define DPROFILE_CONCAT(a, b) DPROFILE_CONCAT_(a, b)
+#ifndef NOPROFILE
+	#define DPROFILE_SCOPE(name) \
+		static const DUtility::DProfileZone DPROFILE_CONCAT(dprofile_zone_, __LINE__) = { name, __FILE__, __LINE__ }; \
+		DUtility::DProfileScope DPROFILE_CONCAT(dprofile_scope_, __LINE__)(&DPROFILE_CONCAT(dprofile_zone_, __LINE__))
+#else
+	#define DPROFILE_SCOPE(name) (void)0
+#endif
+
+#endif// 2026/10/17
@@ -21,6 +21,11 @@ namespace DUtility {
 		double timediff(const std::chrono::time_point<clock> &start, const std::chrono::time_point<clock> &end) {
 			return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
 		}
+
+		///Number of ns between two time objects
+		uint64_t nanoseconds(const std::chrono::time_point<clock> &start, const std::chrono::time_point<clock> &end) {
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		}
 	public:
 		///Creates a Timer which is not running and has no accumulated time
 		DTimer() = default;
@@ -46,6 +51,21 @@ namespace DUtility {
 			return accumulated_time;
 		}
 
+		///Stop the timer, and record the interval since start() in the histogram, as ns.
+		///
+		///@param histogram  A DHistogram (see DHistogram.h).
+		///@return The accumulated time in seconds.
+		template<class Histogram>
+		double stop(Histogram &histogram) {
+			if (!running)
+				throw std::runtime_error("Timer was already stopped!");
+			running = false;
+			const auto end_time = clock::now();
+			accumulated_time += timediff(start_time, end_time);
+			histogram.record(nanoseconds(start_time, end_time));
+			return accumulated_time;
+		}
+
 		///Returns the timer's accumulated time. Throws an exception if the timer is
 		///running.
 		///
@@ -67,6 +87,19 @@ namespace DUtility {
 			return timediff(start_time, lap_time);
 		}
 
+		///Record the time since the timer was started in the histogram, as ns.
+		///
+		///@param histogram  A DHistogram (see DHistogram.h).
+		///@return Time since the timer was started and current moment, in seconds.
+		template<class Histogram>
+		double lap(Histogram &histogram) {
+			if (!running)
+				throw std::runtime_error("Timer was not started!");
+			const auto lap_time = clock::now();
+			histogram.record(nanoseconds(start_time, lap_time));
+			return timediff(start_time, lap_time);
+		}
+
 		///Stops the timer and resets its accumulated time. No exceptions are thrown
 		///ever.
 		void reset() {
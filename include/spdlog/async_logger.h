@@ -22,20 +22,13 @@
 #include "spdlog/common.h"
 #include "spdlog/logger.h"
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <string>
 
 namespace spdlog {
 
-// Async overflow policy - block by default.
-enum class async_overflow_policy
-{
-    block,         // Block until message can be enqueued
-    overrun_oldest // Discard oldest message in the queue if full when trying to
-                   // add new item.
-};
-
 namespace details {
 class thread_pool;
 }
@@ -57,16 +50,32 @@ public:
 
     std::shared_ptr<logger> clone(std::string new_name) override;
 
+    // deferred formatting: when all the arguments are arithmetic, enums or void pointers, copy them
+    // in binary form to the queue and format them in the thread pool instead of the caller's thread.
+    // the format string is referenced, not copied: it must outlive the message (e.g. a literal).
+    // other arguments are formatted by the caller as usual.
+    // not thread safe: set it before logging.
+    void set_deferred_formatting(bool enabled);
+
 protected:
     void sink_it_(details::log_msg &msg) override;
     void flush_() override;
 
-    void backend_log_(const details::log_msg &incoming_log_msg);
+    void backend_log_batch_(const details::log_msg *incoming_log_msgs, size_t count);
     void backend_flush_();
+    void backend_format_(const details::log_msg &incoming_log_msg, fmt::memory_buffer &dest);
+    bool backend_needs_deferred_text_() const;
 
 private:
+    // post through the pool found by thread_pool_, attaching to it first
+    template<typename Post>
+    void post_attached_(Post post, const char *no_pool_error);
+
     std::weak_ptr<details::thread_pool> thread_pool_;
     async_overflow_policy overflow_policy_;
+    // the pool while it holds this logger (it clears it to release the logger, and before it is
+    // destroyed): the log calls post through it without locking thread_pool_
+    std::atomic<details::thread_pool *> attached_pool_{nullptr};
 };
 } // namespace spdlog
 
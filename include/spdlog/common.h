@@ -130,6 +130,30 @@ enum class pattern_time_type
     utc    // log utc
 };
 
+//
+// Clock policy - how the loggers get the time of the log messages (see details/clock.h).
+// system by default
+//
+enum class clock_policy
+{
+    system, // log_clock::now() (or the coarse clock if SPDLOG_CLOCK_COARSE is defined)
+    coarse, // the coarse real time clock of the os (ms resolution or so)
+    cached, // the time stored by a ticker thread every SPDLOG_CACHED_CLOCK_INTERVAL_MS
+    tsc     // cpu ticks, converted to the time before the sinks get the message (by the backend in async loggers)
+};
+
+//
+// Async overflow policy - block by default.
+// (async loggers, and the workers of sinks::async_dist_sink)
+//
+enum class async_overflow_policy
+{
+    block,          // Block until message can be enqueued
+    overrun_oldest, // Discard oldest message in the queue if full when trying to
+                    // add new item.
+    discard_new     // Discard the new message if the queue is full
+};
+
 //
 // Log exception
 //
@@ -10,6 +10,7 @@
 
 #include "spdlog/details/thread_pool.h"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <string>
@@ -41,52 +42,96 @@ inline void spdlog::async_logger::sink_it_(details::log_msg &msg)
 #if defined(SPDLOG_ENABLE_MESSAGE_COUNTER)
     incr_msg_counter_(msg);
 #endif
-    if (auto pool_ptr = thread_pool_.lock())
-    {
-        pool_ptr->post_log(shared_from_this(), std::move(msg), overflow_policy_);
-    }
-    else
+    if (auto *pool = attached_pool_.load(std::memory_order_acquire))
     {
-        throw spdlog_ex("async log: thread pool doesn't exist anymore");
+        pool->post_log(this, std::move(msg), overflow_policy_);
+        return;
     }
+    post_attached_([&](details::thread_pool &pool) { pool.post_log(this, std::move(msg), overflow_policy_); },
+        "async log: thread pool doesn't exist anymore");
 }
 
 // send flush request to the thread pool
 inline void spdlog::async_logger::flush_()
+{
+    if (auto *pool = attached_pool_.load(std::memory_order_acquire))
+    {
+        pool->post_flush(this);
+        return;
+    }
+    post_attached_([&](details::thread_pool &pool) { pool.post_flush(this); }, "async flush: thread pool doesn't exist anymore");
+}
+
+// the queued messages refer to this logger by raw pointer. hand a reference to the pool, which
+// keeps the logger alive until all its messages are processed: on first use, and again when
+// used after the pool started releasing it (see thread_pool::collect_loggers_()).
+template<typename Post>
+inline void spdlog::async_logger::post_attached_(Post post, const char *no_pool_error)
 {
     if (auto pool_ptr = thread_pool_.lock())
     {
-        pool_ptr->post_flush(shared_from_this(), overflow_policy_);
+        pool_ptr->attach_logger(shared_from_this());
+        post(*pool_ptr);
     }
     else
     {
-        throw spdlog_ex("async flush: thread pool doesn't exist anymore");
+        throw spdlog_ex(no_pool_error);
     }
 }
 
 //
 // backend functions - called from the thread pool to do the actual job
 //
-inline void spdlog::async_logger::backend_log_(const details::log_msg &incoming_log_msg)
+// log consecutive messages of this logger at once, so each sink can write them in one go.
+// a sink throwing doesn't keep the other sinks from logging the batch.
+inline void spdlog::async_logger::backend_log_batch_(const details::log_msg *incoming_log_msgs, size_t count)
 {
-    try
+    for (auto &s : sinks_)
     {
-        for (auto &s : sinks_)
+        try
         {
-            if (s->should_log(incoming_log_msg.level))
+            if (std::all_of(incoming_log_msgs, incoming_log_msgs + count, [&](const details::log_msg &msg) { return s->should_log(msg.level); }))
+            {
+                s->log_batch(incoming_log_msgs, count);
+                continue;
+            }
+            for (size_t i = 0; i < count; i++)
             {
-                s->log(incoming_log_msg);
+                if (s->should_log(incoming_log_msgs[i].level))
+                {
+                    s->log(incoming_log_msgs[i]);
+                }
             }
         }
+        SPDLOG_CATCH_AND_HANDLE
     }
-    SPDLOG_CATCH_AND_HANDLE
 
-    if (should_flush_(incoming_log_msg))
+    for (size_t i = 0; i < count; i++)
     {
-        backend_flush_();
+        if (should_flush_(incoming_log_msgs[i]))
+        {
+            backend_flush_();
+            break;
+        }
     }
 }
 
+// format the captured arguments of a message logged with deferred formatting.
+// on error, the format string itself is used as the message text.
+inline void spdlog::async_logger::backend_format_(const details::log_msg &incoming_log_msg, fmt::memory_buffer &dest)
+{
+    size_t start = dest.size();
+    try
+    {
+        incoming_log_msg.deferred_info->format(incoming_log_msg.deferred_fmt, incoming_log_msg.deferred_args.data(), dest);
+        return;
+    }
+    SPDLOG_CATCH_AND_HANDLE
+
+    dest.resize(start);
+    details::fmt_helper::append_string_view(spdlog::string_view_t(incoming_log_msg.deferred_fmt), dest);
+}
+
 inline void spdlog::async_logger::backend_flush_()
 {
     try
@@ -99,6 +144,16 @@ inline void spdlog::async_logger::backend_flush_()
     SPDLOG_CATCH_AND_HANDLE
 }
 
+inline bool spdlog::async_logger::backend_needs_deferred_text_() const
+{
+    return std::any_of(sinks_.begin(), sinks_.end(), [](const sink_ptr &s) { return s->needs_deferred_text(); });
+}
+
+inline void spdlog::async_logger::set_deferred_formatting(bool enabled)
+{
+    deferred_formatting_ = enabled;
+}
+
 inline std::shared_ptr<spdlog::logger> spdlog::async_logger::clone(std::string new_name)
 {
     auto cloned = std::make_shared<spdlog::async_logger>(std::move(new_name), sinks_.begin(), sinks_.end(), thread_pool_, overflow_policy_);
@@ -106,5 +161,7 @@ inline std::shared_ptr<spdlog::logger> spdlog::async_logger::clone(std::string n
     cloned->set_level(this->level());
     cloned->flush_on(this->flush_level());
     cloned->set_error_handler(this->error_handler());
+    cloned->set_clock(this->clock());
+    cloned->set_deferred_formatting(this->deferred_formatting_);
     return std::move(cloned);
 }
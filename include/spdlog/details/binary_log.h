@@ -0,0 +1,544 @@
+#pragma once
+
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// binary log format, written by sinks::binary_file_sink and read back by the decoder tool.
+//
+// a file is a sequence of records, each starting with its type byte:
+//
+//   header  - magic "\x89SPDLOGB" and a version byte. starts each file (or each append
+//             session), and resets the tables below.
+//   name    - varint id, varint size, bytes: interned logger name.
+//   format  - varint id, varint size, bytes, varint args count, then a (tag, size) byte pair
+//             per argument (see deferred_format_info): interned format string of deferred
+//             formatting messages.
+//   message - zigzag varint time delta from the previous message (nanoseconds since epoch for
+//             the first one), varint thread id, level byte, varint logger name id, then
+//             varint format id + 1 and its encoded arguments, or 0 and the varint size and
+//             bytes of the formatted text.
+//
+// arguments: signed integers as zigzag varints, unsigned integers and pointers as varints,
+// bool and char as one byte, floating point values as the 8 bytes (little endian) of a double.
+// long doubles are narrowed to double.
+
+#include "spdlog/common.h"
+#include "spdlog/details/deferred_args.h"
+#include "spdlog/details/log_msg.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace spdlog {
+namespace details {
+namespace binary_log {
+
+enum record_type : unsigned char
+{
+    record_name = 1,
+    record_format = 2,
+    record_message = 3,
+    record_header = 0x89
+};
+
+static const char magic[] = "\x89SPDLOGB";
+static const size_t magic_size = sizeof(magic) - 1;
+static const unsigned char version = 1;
+
+inline void write_varint(uint64_t value, fmt::memory_buffer &dest)
+{
+    while (value >= 0x80)
+    {
+        dest.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    dest.push_back(static_cast<char>(value));
+}
+
+inline uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void write_bytes(const char *data, size_t size, fmt::memory_buffer &dest)
+{
+    write_varint(size, dest);
+    dest.append(data, data + size);
+}
+
+inline void write_double(double value, fmt::memory_buffer &dest)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++)
+    {
+        dest.push_back(static_cast<char>(bits >> (i * 8)));
+    }
+}
+
+// read a native integer of the given size (as captured by deferred_args)
+template<typename Int>
+inline Int read_native(const char *src, size_t size)
+{
+    switch (size)
+    {
+    case 1:
+    {
+        typename std::conditional<std::is_signed<Int>::value, int8_t, uint8_t>::type v;
+        std::memcpy(&v, src, 1);
+        return static_cast<Int>(v);
+    }
+    case 2:
+    {
+        typename std::conditional<std::is_signed<Int>::value, int16_t, uint16_t>::type v;
+        std::memcpy(&v, src, 2);
+        return static_cast<Int>(v);
+    }
+    case 4:
+    {
+        typename std::conditional<std::is_signed<Int>::value, int32_t, uint32_t>::type v;
+        std::memcpy(&v, src, 4);
+        return static_cast<Int>(v);
+    }
+    default:
+    {
+        Int v;
+        std::memcpy(&v, src, sizeof(Int));
+        return v;
+    }
+    }
+}
+
+inline double read_native_double(const char *src, size_t size)
+{
+    if (size == sizeof(float))
+    {
+        float v;
+        std::memcpy(&v, src, sizeof(v));
+        return v;
+    }
+    if (size == sizeof(double))
+    {
+        double v;
+        std::memcpy(&v, src, sizeof(v));
+        return v;
+    }
+    long double v;
+    std::memcpy(&v, src, sizeof(v));
+    return static_cast<double>(v);
+}
+
+//
+// encoder - keeps the interning tables of the file being written
+//
+class encoder
+{
+public:
+    // start a new file (or append session): write the header and reset the tables
+    void begin(fmt::memory_buffer &dest)
+    {
+        names_.clear();
+        formats_.clear();
+        next_id_ = 0;
+        last_time_ = 0;
+        dest.append(magic, magic + magic_size);
+        dest.push_back(static_cast<char>(version));
+    }
+
+    void encode(const log_msg &msg, fmt::memory_buffer &dest)
+    {
+        uint64_t name_id = name_id_(*msg.logger_name, dest);
+        uint64_t format_id = msg.deferred_info != nullptr ? format_id_(msg, dest) + 1 : 0;
+
+        int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+        dest.push_back(static_cast<char>(record_message));
+        write_varint(zigzag(time - last_time_), dest);
+        last_time_ = time;
+        write_varint(msg.thread_id, dest);
+        dest.push_back(static_cast<char>(msg.level));
+        write_varint(name_id, dest);
+        write_varint(format_id, dest);
+        if (format_id == 0)
+        {
+            write_bytes(msg.payload.data(), msg.payload.size(), dest);
+            return;
+        }
+
+        const auto &info = *msg.deferred_info;
+        const char *src = msg.deferred_args.data();
+        for (size_t i = 0; i < info.args_n; i++)
+        {
+            size_t size = info.arg_sizes[i];
+            switch (info.arg_types[i])
+            {
+            case 'i':
+                write_varint(zigzag(read_native<int64_t>(src, size)), dest);
+                break;
+            case 'u':
+            case 'p':
+                write_varint(read_native<uint64_t>(src, size), dest);
+                break;
+            case 'f':
+                write_double(read_native_double(src, size), dest);
+                break;
+            default: // 'b', 'c'
+                dest.push_back(*src);
+                break;
+            }
+            src += size;
+        }
+    }
+
+private:
+    struct format_key_hash
+    {
+        size_t operator()(const std::pair<const char *, const deferred_format_info *> &key) const
+        {
+            return std::hash<const void *>()(key.first) ^ (std::hash<const void *>()(key.second) << 1);
+        }
+    };
+
+    uint64_t name_id_(const std::string &name, fmt::memory_buffer &dest)
+    {
+        auto it = names_.find(name);
+        if (it != names_.end())
+        {
+            return it->second;
+        }
+        uint64_t id = next_id_++;
+        names_.emplace(name, id);
+        dest.push_back(static_cast<char>(record_name));
+        write_varint(id, dest);
+        write_bytes(name.data(), name.size(), dest);
+        return id;
+    }
+
+    // format strings of deferred formatting messages are static, so they are keyed by address
+    uint64_t format_id_(const log_msg &msg, fmt::memory_buffer &dest)
+    {
+        auto key = std::make_pair(msg.deferred_fmt, msg.deferred_info);
+        auto it = formats_.find(key);
+        if (it != formats_.end())
+        {
+            return it->second;
+        }
+        uint64_t id = next_id_++;
+        formats_.emplace(key, id);
+        dest.push_back(static_cast<char>(record_format));
+        write_varint(id, dest);
+        write_bytes(msg.deferred_fmt, std::strlen(msg.deferred_fmt), dest);
+        const auto &info = *msg.deferred_info;
+        write_varint(info.args_n, dest);
+        for (size_t i = 0; i < info.args_n; i++)
+        {
+            dest.push_back(info.arg_types[i]);
+            dest.push_back(static_cast<char>(info.arg_sizes[i]));
+        }
+        return id;
+    }
+
+    std::unordered_map<std::string, uint64_t> names_;
+    std::unordered_map<std::pair<const char *, const deferred_format_info *>, uint64_t, format_key_hash> formats_;
+    uint64_t next_id_ = 0;
+    int64_t last_time_ = 0;
+};
+
+//
+// decoder - reads back the messages of a binary log
+//
+struct decoded_msg
+{
+    level::level_enum level{level::off};
+    log_clock::time_point time;
+    size_t thread_id{0};
+    const std::string *logger_name{nullptr};
+    fmt::memory_buffer text;
+};
+
+class decoder
+{
+public:
+    decoder(const char *data, size_t size)
+        : pos_(data)
+        , end_(data + size)
+    {
+    }
+
+    // decode the next message. return false at the end of the data.
+    // throw spdlog_ex on corrupt or truncated data.
+    bool next(decoded_msg &msg)
+    {
+        while (pos_ != end_)
+        {
+            auto type = static_cast<unsigned char>(*pos_++);
+            switch (type)
+            {
+            case record_header:
+                read_header_();
+                break;
+            case record_name:
+            {
+                uint64_t id = read_varint_();
+                names_.emplace_back(read_string_());
+                define_(id, entry{&names_.back(), nullptr});
+                break;
+            }
+            case record_format:
+                read_format_();
+                break;
+            case record_message:
+                read_message_(msg);
+                return true;
+            default:
+                throw spdlog_ex("binary log: unknown record type " + std::to_string(type));
+            }
+        }
+        return false;
+    }
+
+private:
+    struct format_entry
+    {
+        std::string fmt;
+        std::string arg_types;
+    };
+
+    struct entry
+    {
+        const std::string *name;
+        const format_entry *format;
+    };
+
+    void need_(size_t n)
+    {
+        if (static_cast<size_t>(end_ - pos_) < n)
+        {
+            throw spdlog_ex("binary log: truncated record");
+        }
+    }
+
+    uint64_t read_varint_()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            need_(1);
+            auto byte = static_cast<unsigned char>(*pos_++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw spdlog_ex("binary log: invalid varint");
+    }
+
+    std::string read_string_()
+    {
+        auto size = static_cast<size_t>(read_varint_());
+        need_(size);
+        std::string s(pos_, size);
+        pos_ += size;
+        return s;
+    }
+
+    double read_double_()
+    {
+        need_(8);
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            bits |= static_cast<uint64_t>(static_cast<unsigned char>(*pos_++)) << (i * 8);
+        }
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void read_header_()
+    {
+        need_(magic_size);
+        if (std::memcmp(pos_ - 1, magic, magic_size) != 0)
+        {
+            throw spdlog_ex("binary log: bad magic");
+        }
+        pos_ += magic_size - 1;
+        need_(1);
+        auto file_version = static_cast<unsigned char>(*pos_++);
+        if (file_version != version)
+        {
+            throw spdlog_ex("binary log: unsupported version " + std::to_string(file_version));
+        }
+        table_.clear();
+        last_time_ = 0;
+    }
+
+    void read_format_()
+    {
+        uint64_t id = read_varint_();
+        format_entry f;
+        f.fmt = read_string_();
+        auto args_n = read_varint_();
+        if (args_n > static_cast<uint64_t>(end_ - pos_) / 2)
+        {
+            throw spdlog_ex("binary log: truncated record");
+        }
+        for (size_t i = 0; i < args_n; i++)
+        {
+            f.arg_types.push_back(pos_[0]);
+            pos_ += 2; // the captured size is not needed to decode
+        }
+        formats_.push_back(std::move(f));
+        define_(id, entry{nullptr, &formats_.back()});
+    }
+
+    void read_message_(decoded_msg &msg)
+    {
+        // unsigned, a corrupt delta must not overflow
+        last_time_ = static_cast<int64_t>(static_cast<uint64_t>(last_time_) + static_cast<uint64_t>(unzigzag(read_varint_())));
+        msg.time = log_clock::time_point(std::chrono::duration_cast<log_clock::duration>(std::chrono::nanoseconds(last_time_)));
+        msg.thread_id = static_cast<size_t>(read_varint_());
+        need_(1);
+        auto level_byte = static_cast<unsigned char>(*pos_++);
+        if (level_byte > level::off)
+        {
+            throw spdlog_ex("binary log: bad level " + std::to_string(level_byte));
+        }
+        msg.level = static_cast<level::level_enum>(level_byte);
+        msg.logger_name = lookup_(read_varint_()).name;
+        if (msg.logger_name == nullptr)
+        {
+            throw spdlog_ex("binary log: bad logger name id");
+        }
+
+        msg.text.resize(0);
+        uint64_t format_id = read_varint_();
+        if (format_id == 0)
+        {
+            auto size = static_cast<size_t>(read_varint_());
+            need_(size);
+            msg.text.append(pos_, pos_ + size);
+            pos_ += size;
+            return;
+        }
+
+        const format_entry *f = lookup_(format_id - 1).format;
+        if (f == nullptr)
+        {
+            throw spdlog_ex("binary log: bad format id");
+        }
+        values_.clear();
+        for (char tag : f->arg_types)
+        {
+            value v;
+            v.tag = tag;
+            switch (tag)
+            {
+            case 'i':
+                v.i = unzigzag(read_varint_());
+                break;
+            case 'u':
+            case 'p':
+                v.u = read_varint_();
+                break;
+            case 'f':
+                v.d = read_double_();
+                break;
+            default: // 'b', 'c'
+                need_(1);
+                v.c = *pos_++;
+                break;
+            }
+            values_.push_back(v);
+        }
+
+        args_.clear();
+        for (const auto &v : values_)
+        {
+            args_.push_back(make_arg_(v));
+        }
+        // terminated by a none argument, as fmt's own argument arrays (it scans them for named
+        // arguments)
+        args_.emplace_back();
+        fmt::vformat_to(msg.text, f->fmt, fmt::format_args(args_.data(), static_cast<unsigned>(args_.size() - 1)));
+    }
+
+    struct value
+    {
+        char tag;
+        union
+        {
+            int64_t i;
+            uint64_t u;
+            double d;
+            char c;
+        };
+    };
+
+    static fmt::basic_format_arg<fmt::format_context> make_arg_(const value &v)
+    {
+        using fmt::internal::make_arg;
+        switch (v.tag)
+        {
+        case 'i':
+            return make_arg<fmt::format_context>(static_cast<long long>(v.i));
+        case 'u':
+            return make_arg<fmt::format_context>(static_cast<unsigned long long>(v.u));
+        case 'p':
+            return make_arg<fmt::format_context>(reinterpret_cast<const void *>(static_cast<uintptr_t>(v.u)));
+        case 'f':
+            return make_arg<fmt::format_context>(v.d);
+        case 'b':
+            return make_arg<fmt::format_context>(v.c != 0);
+        default:
+            return make_arg<fmt::format_context>(v.c);
+        }
+    }
+
+    // the encoder numbers the names and formats of a file in order, so a new id is the next one
+    void define_(uint64_t id, entry e)
+    {
+        if (id > table_.size())
+        {
+            throw spdlog_ex("binary log: bad id " + std::to_string(id));
+        }
+        if (id == table_.size())
+        {
+            table_.push_back(e);
+            return;
+        }
+        table_[static_cast<size_t>(id)] = e;
+    }
+
+    entry lookup_(uint64_t id) const
+    {
+        return id < table_.size() ? table_[static_cast<size_t>(id)] : entry{nullptr, nullptr};
+    }
+
+    const char *pos_;
+    const char *end_;
+    int64_t last_time_ = 0;
+    std::vector<entry> table_;
+    // deques keep the addresses of the entries stable
+    std::deque<std::string> names_;
+    std::deque<format_entry> formats_;
+    std::vector<value> values_;
+    std::vector<fmt::basic_format_arg<fmt::format_context>> args_;
+};
+
+} // namespace binary_log
+} // namespace details
+} // namespace spdlog
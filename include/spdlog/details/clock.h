@@ -0,0 +1,262 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Clock sources of the log message time (see spdlog::clock_policy):
+//
+// coarse_now()    - the coarse real time clock of the os (CLOCK_REALTIME_COARSE on linux,
+//                   GetSystemTimeAsFileTime on windows). log_clock::now() elsewhere.
+// cached_clock    - the time stored by a ticker thread every SPDLOG_CACHED_CLOCK_INTERVAL_MS.
+//                   Reading it is a single relaxed load.
+// tsc_clock       - the cpu ticks (rdtsc on x86, CLOCK_MONOTONIC_RAW elsewhere on linux).
+//                   The logging thread only reads the ticks, the time is computed from them
+//                   later (by the async backend, or before the sinks in sync loggers), using
+//                   the ticks/system clock pairs sampled by the calibration.
+//                   The calibration is refreshed when the ticks are more than a second past
+//                   the last one, so the rate follows the system clock (e.g. ntp adjustments).
+//                   Assumes the ticks are synchronized between the cores (invariant tsc).
+
+#include "spdlog/common.h"
+#include "spdlog/details/os.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SPDLOG_RDTSC_() __rdtsc()
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define SPDLOG_RDTSC_() __rdtsc()
+#endif
+
+#ifndef SPDLOG_CACHED_CLOCK_INTERVAL_MS
+#define SPDLOG_CACHED_CLOCK_INTERVAL_MS 1
+#endif
+
+namespace spdlog {
+namespace details {
+
+inline log_clock::time_point coarse_now() SPDLOG_NOEXCEPT
+{
+#if defined(__linux__)
+    timespec ts;
+    ::clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return log_clock::time_point(
+        std::chrono::duration_cast<log_clock::duration>(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+#elif defined(_WIN32)
+    FILETIME ft;
+    ::GetSystemTimeAsFileTime(&ft);
+    // 100ns intervals since 1601-01-01
+    long long intervals = static_cast<long long>((static_cast<unsigned long long>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime);
+    intervals -= 116444736000000000LL;
+    return log_clock::time_point(std::chrono::duration_cast<log_clock::duration>(std::chrono::nanoseconds(intervals * 100)));
+#else
+    return log_clock::now();
+#endif
+}
+
+class cached_clock
+{
+public:
+    // the first call starts the ticker thread
+    static log_clock::time_point now()
+    {
+        return log_clock::time_point(log_clock::duration(instance().now_.load(std::memory_order_relaxed)));
+    }
+
+    static cached_clock &instance()
+    {
+        static cached_clock clock;
+        return clock;
+    }
+
+    cached_clock(const cached_clock &) = delete;
+    cached_clock &operator=(const cached_clock &) = delete;
+
+    ~cached_clock()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        ticker_.join();
+    }
+
+private:
+    cached_clock()
+        : now_(log_clock::now().time_since_epoch().count())
+    {
+        ticker_ = std::thread([this] { tick_(); });
+    }
+
+    void tick_()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, std::chrono::milliseconds(SPDLOG_CACHED_CLOCK_INTERVAL_MS), [this] { return stop_; }))
+        {
+            now_.store(log_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<log_clock::rep> now_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_{false};
+    std::thread ticker_;
+};
+
+class tsc_clock
+{
+public:
+    static std::uint64_t ticks() SPDLOG_NOEXCEPT
+    {
+#if defined(SPDLOG_RDTSC_)
+        return SPDLOG_RDTSC_();
+#elif defined(__linux__)
+        timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // the first call calibrates the ticks (~1ms)
+    static log_clock::time_point to_time_point(std::uint64_t ticks)
+    {
+        return instance().convert_(ticks);
+    }
+
+    static tsc_clock &instance()
+    {
+        static tsc_clock clock;
+        return clock;
+    }
+
+    tsc_clock(const tsc_clock &) = delete;
+    tsc_clock &operator=(const tsc_clock &) = delete;
+
+private:
+    struct sample
+    {
+        std::uint64_t ticks;
+        long long ns; // system clock, since epoch
+    };
+
+    tsc_clock()
+    {
+        // initial rate over ~1ms. refined by the later calibrations, over a second or more
+        sample first = sample_();
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+        while (std::chrono::steady_clock::now() < until)
+        {
+        }
+        sample second = sample_();
+        double ns_per_tick = second.ticks != first.ticks ? static_cast<double>(second.ns - first.ns) / (second.ticks - first.ticks) : 1.0;
+        publish_(second, ns_per_tick);
+    }
+
+    static sample sample_()
+    {
+        // the system time between two reads of the ticks
+        std::uint64_t before = ticks();
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(log_clock::now().time_since_epoch()).count();
+        std::uint64_t after = ticks();
+        return {before + (after - before) / 2, ns};
+    }
+
+    log_clock::time_point convert_(std::uint64_t ticks)
+    {
+        for (;;)
+        {
+            auto seq = seq_.load(std::memory_order_acquire);
+            std::uint64_t base_ticks = base_ticks_.load(std::memory_order_relaxed);
+            long long base_ns = base_ns_.load(std::memory_order_relaxed);
+            double ns_per_tick = ns_per_tick_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((seq & 1) != 0 || seq != seq_.load(std::memory_order_relaxed))
+            {
+                continue; // calibration in progress
+            }
+            auto elapsed = static_cast<long long>(ticks - base_ticks);
+            if (elapsed > 0 && elapsed * ns_per_tick > 1e9 && recalibrate_(base_ticks))
+            {
+                continue;
+            }
+            auto ns = base_ns + static_cast<long long>(elapsed * ns_per_tick);
+            return log_clock::time_point(std::chrono::duration_cast<log_clock::duration>(std::chrono::nanoseconds(ns)));
+        }
+    }
+
+    // sample the clocks again, and compute the rate since the previous calibration.
+    // return false if another thread is calibrating already (the current one is used meanwhile).
+    bool recalibrate_(std::uint64_t base_ticks)
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            return false;
+        }
+        if (base_ticks_.load(std::memory_order_relaxed) != base_ticks)
+        {
+            return true; // done meanwhile
+        }
+        sample base{base_ticks, base_ns_.load(std::memory_order_relaxed)};
+        double ns_per_tick = ns_per_tick_.load(std::memory_order_relaxed);
+        sample now = sample_();
+        if (now.ticks > base.ticks)
+        {
+            double rate = static_cast<double>(now.ns - base.ns) / (now.ticks - base.ticks);
+            // ignore the steps of the system clock (the base moves to the new time anyway)
+            if (rate > ns_per_tick * 0.99 && rate < ns_per_tick * 1.01)
+            {
+                ns_per_tick = rate;
+            }
+        }
+        publish_(now, ns_per_tick);
+        return true;
+    }
+
+    void publish_(sample base, double ns_per_tick)
+    {
+        auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        base_ticks_.store(base.ticks, std::memory_order_relaxed);
+        base_ns_.store(base.ns, std::memory_order_relaxed);
+        ns_per_tick_.store(ns_per_tick, std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    std::mutex mutex_; // serializes the calibrations
+    std::atomic<unsigned> seq_{0};
+    std::atomic<std::uint64_t> base_ticks_{0};
+    std::atomic<long long> base_ns_{0};
+    std::atomic<double> ns_per_tick_{1.0};
+};
+
+// the time now by the given clock (tsc excluded, its time is computed from the ticks)
+inline log_clock::time_point clock_now(clock_policy policy)
+{
+    switch (policy)
+    {
+    case clock_policy::coarse:
+        return coarse_now();
+    case clock_policy::cached:
+        return cached_clock::now();
+    default:
+        return os::now();
+    }
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,119 @@
+#pragma once
+
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// arguments captured in binary form by the deferred formatting mode of the async logger
+// (see async_logger::set_deferred_formatting()).
+//
+// the caller copies the argument values (in order, native layout) next to the format string
+// pointer. the backend formats them with the format function of the deferred_format_info
+// of that argument list. only trivially copyable values that are formatted by value
+// qualify: arithmetic types, unscoped enums and void pointers.
+
+#include "spdlog/fmt/fmt.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace spdlog {
+namespace details {
+
+struct deferred_format_info
+{
+    // format the captured arguments with the given format string
+    void (*format)(const char *fmt, const char *args, fmt::memory_buffer &dest);
+    size_t args_n;
+    // one tag per argument: b(ool), c(har), i(nt), u(nsigned), f(loating point), p(ointer)
+    const char *arg_types;
+    // sizeof of each argument
+    const unsigned char *arg_sizes;
+};
+
+template<typename T>
+struct is_deferrable_arg
+    : std::integral_constant<bool, std::is_arithmetic<T>::value || (std::is_enum<T>::value && std::is_convertible<T, int>::value) ||
+                                       std::is_same<T, void *>::value || std::is_same<T, const void *>::value>
+{
+};
+
+template<typename T, typename = void>
+struct deferred_arg_tag
+{
+    static const char value = std::is_same<T, bool>::value
+                                  ? 'b'
+                                  : std::is_same<T, char>::value
+                                        ? 'c'
+                                        : std::is_floating_point<T>::value ? 'f' : std::is_pointer<T>::value ? 'p' : std::is_signed<T>::value ? 'i' : 'u';
+};
+
+template<typename T>
+struct deferred_arg_tag<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+    static const char value = std::is_signed<typename std::underlying_type<T>::type>::value ? 'i' : 'u';
+};
+
+template<typename... Args>
+struct deferred_args;
+
+template<>
+struct deferred_args<>
+{
+    static const bool value = true;
+    static const size_t size = 0;
+
+    static void write(char *)
+    {
+    }
+
+    template<typename... Done>
+    static void read_and_format(const char *fmt, const char *, fmt::memory_buffer &dest, const Done &... done)
+    {
+        fmt::format_to(dest, fmt, done...);
+    }
+};
+
+template<typename T, typename... Rest>
+struct deferred_args<T, Rest...>
+{
+    static const bool value = is_deferrable_arg<T>::value && deferred_args<Rest...>::value;
+    static const size_t size = sizeof(T) + deferred_args<Rest...>::size;
+
+    static void write(char *dest, const T &arg, const Rest &... rest)
+    {
+        std::memcpy(dest, &arg, sizeof(T));
+        deferred_args<Rest...>::write(dest + sizeof(T), rest...);
+    }
+
+    template<typename... Done>
+    static void read_and_format(const char *fmt, const char *src, fmt::memory_buffer &dest, const Done &... done)
+    {
+        T arg;
+        std::memcpy(&arg, src, sizeof(T));
+        deferred_args<Rest...>::read_and_format(fmt, src + sizeof(T), dest, done..., arg);
+    }
+
+    static void format(const char *fmt, const char *src, fmt::memory_buffer &dest)
+    {
+        read_and_format(fmt, src, dest);
+    }
+
+    static const char arg_types[];
+    static const unsigned char arg_sizes[];
+    static const deferred_format_info info;
+};
+
+template<typename T, typename... Rest>
+const char deferred_args<T, Rest...>::arg_types[] = {deferred_arg_tag<T>::value, deferred_arg_tag<Rest>::value..., '\0'};
+
+template<typename T, typename... Rest>
+const unsigned char deferred_args<T, Rest...>::arg_sizes[] = {sizeof(T), sizeof(Rest)...};
+
+template<typename T, typename... Rest>
+const deferred_format_info deferred_args<T, Rest...>::info = {
+    &deferred_args<T, Rest...>::format, 1 + sizeof...(Rest), deferred_args<T, Rest...>::arg_types, deferred_args<T, Rest...>::arg_sizes};
+
+} // namespace details
+} // namespace spdlog
@@ -8,10 +8,17 @@
 // Helper class for file sinks.
 // When failing to open a file, retry several times(5) with a delay interval(10 ms).
 // Throw spdlog_ex exception on errors.
+// With SPDLOG_BACKGROUND_FILE_WRITER defined (POSIX only), the writes are done by a
+// background I/O thread (see file_writer.h), so a stalled disk doesn't block the caller.
 
 #include "spdlog/details/log_msg.h"
 #include "spdlog/details/os.h"
 
+#if defined(SPDLOG_BACKGROUND_FILE_WRITER) && !defined(_WIN32)
+#define SPDLOG_USE_BACKGROUND_FILE_WRITER
+#include "spdlog/details/file_writer.h"
+#endif
+
 #include <cerrno>
 #include <chrono>
 #include <cstdio>
@@ -36,20 +43,35 @@ public:
 
     ~file_helper()
     {
-        close();
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
     }
 
     void open(const filename_t &fname, bool truncate = false)
     {
         close();
-        auto *mode = truncate ? SPDLOG_FILENAME_T("wb") : SPDLOG_FILENAME_T("ab");
         _filename = fname;
+#ifdef SPDLOG_USE_BACKGROUND_FILE_WRITER
+        for (int tries = 0; tries < open_tries; ++tries)
+        {
+            if (writer_.open(fname, truncate))
+            {
+                return;
+            }
+#else
+        auto *mode = truncate ? SPDLOG_FILENAME_T("wb") : SPDLOG_FILENAME_T("ab");
         for (int tries = 0; tries < open_tries; ++tries)
         {
             if (!os::fopen_s(&fd_, fname, mode))
             {
                 return;
             }
+#endif
 
             details::os::sleep_for_millis(open_interval);
         }
@@ -68,11 +90,18 @@ public:
 
     void flush()
     {
+#ifdef SPDLOG_USE_BACKGROUND_FILE_WRITER
+        writer_.flush();
+#else
         std::fflush(fd_);
+#endif
     }
 
     void close()
     {
+#ifdef SPDLOG_USE_BACKGROUND_FILE_WRITER
+        writer_.close();
+#endif
         if (fd_ != nullptr)
         {
             std::fclose(fd_);
@@ -82,21 +111,33 @@ public:
 
     void write(const fmt::memory_buffer &buf)
     {
+#ifdef SPDLOG_USE_BACKGROUND_FILE_WRITER
+        writer_.write(buf.data(), buf.size());
+#else
         size_t msg_size = buf.size();
         auto data = buf.data();
         if (std::fwrite(data, 1, msg_size, fd_) != msg_size)
         {
             throw spdlog_ex("Failed writing to file " + os::filename_to_str(_filename), errno);
         }
+#endif
     }
 
     size_t size() const
     {
+#ifdef SPDLOG_USE_BACKGROUND_FILE_WRITER
+        if (!writer_.is_open())
+        {
+            throw spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(_filename));
+        }
+        return writer_.size();
+#else
         if (fd_ == nullptr)
         {
             throw spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(_filename));
         }
         return os::filesize(fd_);
+#endif
     }
 
     const filename_t &filename() const
@@ -146,6 +187,9 @@ public:
 
 private:
     std::FILE *fd_{nullptr};
+#ifdef SPDLOG_USE_BACKGROUND_FILE_WRITER
+    background_file_writer writer_;
+#endif
     filename_t _filename;
 };
 } // namespace details
@@ -0,0 +1,254 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Double buffered file writer with a background I/O thread (POSIX only).
+// Used by file_helper when SPDLOG_BACKGROUND_FILE_WRITER is defined in tweakme.h.
+//
+// write(..) - appends to the active buffer. the buffer is handed to the I/O thread once it
+// holds submit_size bytes and the I/O thread is idle, so a stalled disk only makes the
+// buffer grow (up to max_size, then the caller waits for the write in flight).
+// the handed over writes end on a block_size boundary of the file (the rest stays in the
+// active buffer), so the disk gets whole pages. the files are not opened with O_DIRECT, which
+// would also need aligned memory and lengths for the flushes and doesn't mix with O_APPEND.
+// flush() - hands the whole active buffer over and waits until it's written.
+// I/O errors are reported by the next call to write(..)/flush()/close().
+// Not thread safe: the sinks serialize the calls.
+
+#include "spdlog/common.h"
+#include "spdlog/details/os.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace spdlog {
+namespace details {
+
+class background_file_writer
+{
+public:
+    static const size_t block_size = 4 * 1024;
+    static const size_t submit_size = 8 * 1024;
+    static const size_t max_size = 1024 * 1024;
+
+    background_file_writer() = default;
+
+    background_file_writer(const background_file_writer &) = delete;
+    background_file_writer &operator=(const background_file_writer &) = delete;
+
+    ~background_file_writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+        if (thread_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            thread_.join();
+        }
+    }
+
+    // return false (and set errno) on failure
+    bool open(const filename_t &fname, bool truncate)
+    {
+        close();
+        int flags = O_WRONLY | O_CREAT | (truncate ? O_TRUNC : O_APPEND);
+#ifdef O_CLOEXEC
+        flags |= O_CLOEXEC;
+#endif
+        int fd = ::open(fname.c_str(), flags, 0644);
+        if (fd == -1)
+        {
+            return false;
+        }
+        struct stat st;
+        size_ = ::fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+        filename_ = fname;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fd_ = fd;
+            error_ = 0;
+        }
+        if (!thread_.joinable())
+        {
+            thread_ = std::thread(&background_file_writer::io_loop_, this);
+        }
+        return true;
+    }
+
+    bool is_open() const
+    {
+        return fd_ != -1;
+    }
+
+    void write(const char *data, size_t size)
+    {
+        active_.append(data, data + size);
+        size_ += size;
+        if (active_.size() >= submit_size)
+        {
+            submit_(active_.size() >= max_size, false);
+        }
+    }
+
+    void flush()
+    {
+        submit_(true, true);
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !busy_; });
+        check_error_();
+    }
+
+    void close()
+    {
+        if (fd_ == -1)
+        {
+            return;
+        }
+        try
+        {
+            flush();
+        }
+        catch (...)
+        {
+            close_fd_();
+            throw;
+        }
+        close_fd_();
+    }
+
+    // written size, including the buffered bytes
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    // hand the active buffer to the I/O thread (all of it, or up to the last block boundary of
+    // the file). if it's still writing the previous one, wait for it only if asked to, otherwise
+    // keep buffering.
+    void submit_(bool wait, bool all)
+    {
+        // the active buffer ends at size_ in the file
+        size_t tail = all ? 0 : size_ % block_size;
+        if (active_.size() <= tail)
+        {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (busy_)
+            {
+                if (!wait)
+                {
+                    return;
+                }
+                cv_.wait(lock, [this] { return !busy_; });
+            }
+            check_error_();
+            std::swap(active_, in_flight_);
+            if (tail != 0)
+            {
+                size_t submitted = in_flight_.size() - tail;
+                active_.append(in_flight_.data() + submitted, in_flight_.data() + in_flight_.size());
+                in_flight_.resize(submitted);
+            }
+            busy_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    void close_fd_()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ::close(fd_);
+        fd_ = -1;
+        active_.resize(0);
+    }
+
+    void check_error_()
+    {
+        if (error_ != 0)
+        {
+            int err = error_;
+            error_ = 0;
+            throw spdlog_ex("Failed writing to file " + os::filename_to_str(filename_), err);
+        }
+    }
+
+    void io_loop_()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            cv_.wait(lock, [this] { return busy_ || stop_; });
+            if (!busy_)
+            {
+                return;
+            }
+            int fd = fd_;
+            lock.unlock();
+
+            // the in flight buffer is owned by this thread while busy_ is set
+            int err = 0;
+            const char *data = in_flight_.data();
+            size_t left = in_flight_.size();
+            while (left != 0)
+            {
+                auto written = ::write(fd, data, left);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    err = errno;
+                    break;
+                }
+                data += written;
+                left -= static_cast<size_t>(written);
+            }
+            in_flight_.resize(0);
+
+            lock.lock();
+            if (err != 0)
+            {
+                error_ = err;
+            }
+            busy_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    filename_t filename_;
+    size_t size_ = 0;
+    fmt::memory_buffer active_;
+    fmt::memory_buffer in_flight_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int fd_ = -1;
+    bool busy_ = false;
+    bool stop_ = false;
+    int error_ = 0;
+    std::thread thread_;
+};
+
+} // namespace details
+} // namespace spdlog
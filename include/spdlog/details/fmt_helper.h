@@ -8,6 +8,8 @@
 #include "spdlog/details/log_msg.h"
 #include "spdlog/fmt/fmt.h"
 
+#include <type_traits>
+
 // Some fmt helpers to efficiently format and pad ints and strings
 namespace spdlog {
 namespace details {
@@ -35,9 +37,60 @@ inline void append_string_view(spdlog::string_view_t view, fmt::basic_memory_buf
     }
 }
 
+// "00", "01", .. "99" - the two digits of n (0-99)
+inline const char *digits2(unsigned n) SPDLOG_NOEXCEPT
+{
+    static const char digits[] = "0001020304050607080910111213141516171819"
+                                 "2021222324252627282930313233343536373839"
+                                 "4041424344454647484950515253545556575859"
+                                 "6061626364656667686970717273747576777879"
+                                 "8081828384858687888990919293949596979899";
+    return digits + n * 2;
+}
+
+// write the two digits of n (0-99) at p
+inline char *write2(char *p, unsigned n) SPDLOG_NOEXCEPT
+{
+    const char *d = digits2(n);
+    p[0] = d[0];
+    p[1] = d[1];
+    return p + 2;
+}
+
 template<typename T, size_t Buffer_Size>
 inline void append_int(T n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
 {
+    // small non negative numbers (days, years..) straight from the digits table
+    auto u = static_cast<typename std::make_unsigned<T>::type>(n);
+    if (u < 100)
+    {
+        if (u < 10)
+        {
+            dest.push_back(static_cast<char>('0' + u));
+            return;
+        }
+        const char *d = digits2(static_cast<unsigned>(u));
+        dest.push_back(d[0]);
+        dest.push_back(d[1]);
+        return;
+    }
+    if (u < 10000)
+    {
+        char buf[4];
+        char *p = buf;
+        auto v = static_cast<unsigned>(u);
+        if (v < 1000)
+        {
+            *p++ = static_cast<char>('0' + v / 100);
+        }
+        else
+        {
+            p = write2(p, v / 100);
+        }
+        p = write2(p, v % 100);
+        dest.append(buf, p);
+        return;
+    }
     fmt::format_int i(n);
     dest.append(i.data(), i.data() + i.size());
 }
@@ -45,21 +98,17 @@ inline void append_int(T n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
 template<size_t Buffer_Size>
 inline void pad2(int n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
 {
-    if (n > 99)
-    {
-        append_int(n, dest);
-        return;
-    }
-    if (n > 9) // 10-99
+    // two push_backs are cheaper than an append of 2 chars
+    if (n >= 0 && n < 100)
     {
-        dest.push_back(static_cast<char>('0' + n / 10));
-        dest.push_back(static_cast<char>('0' + n % 10));
+        const char *d = digits2(static_cast<unsigned>(n));
+        dest.push_back(d[0]);
+        dest.push_back(d[1]);
         return;
     }
-    if (n >= 0) // 0-9
+    if (n > 99)
     {
-        dest.push_back('0');
-        dest.push_back(static_cast<char>('0' + n));
+        append_int(n, dest);
         return;
     }
     // negatives (unlikely, but just in case, let fmt deal with it)
@@ -69,46 +118,79 @@ inline void pad2(int n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
 template<size_t Buffer_Size>
 inline void pad3(int n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
 {
-    if (n > 999)
+    if (n >= 0 && n < 1000)
     {
-        append_int(n, dest);
+        auto v = static_cast<unsigned>(n);
+        char buf[3];
+        buf[0] = static_cast<char>('0' + v / 100);
+        write2(buf + 1, v % 100);
+        dest.append(buf, buf + 3);
         return;
     }
-
-    if (n > 99) // 100-999
+    if (n > 999)
     {
-        dest.push_back(static_cast<char>('0' + n / 100));
-        pad2(n % 100, dest);
+        append_int(n, dest);
         return;
     }
-    if (n > 9) // 10-99
+    // negatives (unlikely, but just in case let fmt deal with it)
+    fmt::format_to(dest, "{:03}", n);
+}
+
+template<size_t Buffer_Size>
+inline void pad6(size_t n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
+{
+    if (n > 999999)
     {
-        dest.push_back('0');
-        dest.push_back(static_cast<char>('0' + n / 10));
-        dest.push_back(static_cast<char>('0' + n % 10));
+        append_int(n, dest);
         return;
     }
-    if (n >= 0)
+    auto v = static_cast<unsigned>(n);
+    char buf[6];
+    write2(buf, v / 10000);
+    write2(buf + 2, v / 100 % 100);
+    write2(buf + 4, v % 100);
+    dest.append(buf, buf + 6);
+}
+
+template<size_t Buffer_Size>
+inline void pad9(size_t n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
+{
+    if (n > 999999999)
     {
-        dest.push_back('0');
-        dest.push_back('0');
-        dest.push_back(static_cast<char>('0' + n));
+        append_int(n, dest);
         return;
     }
-    // negatives (unlikely, but just in case let fmt deal with it)
-    fmt::format_to(dest, "{:03}", n);
+    auto v = static_cast<unsigned>(n);
+    char buf[9];
+    buf[0] = static_cast<char>('0' + v / 100000000);
+    v %= 100000000;
+    write2(buf + 1, v / 1000000);
+    write2(buf + 3, v / 10000 % 100);
+    write2(buf + 5, v / 100 % 100);
+    write2(buf + 7, v % 100);
+    dest.append(buf, buf + 9);
 }
 
+// HH:MM:SS in one append (each of h, m, s 0-99)
 template<size_t Buffer_Size>
-inline void pad6(size_t n, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
+inline void append_hms(int h, int m, int s, fmt::basic_memory_buffer<char, Buffer_Size> &dest)
 {
-    if (n > 99999)
+    if (static_cast<unsigned>(h) > 99 || static_cast<unsigned>(m) > 99 || static_cast<unsigned>(s) > 99)
     {
-        append_int(n, dest);
+        pad2(h, dest);
+        dest.push_back(':');
+        pad2(m, dest);
+        dest.push_back(':');
+        pad2(s, dest);
         return;
     }
-    pad3(static_cast<int>(n / 1000), dest);
-    pad3(static_cast<int>(n % 1000), dest);
+    char buf[8];
+    write2(buf, static_cast<unsigned>(h));
+    buf[2] = ':';
+    write2(buf + 3, static_cast<unsigned>(m));
+    buf[5] = ':';
+    write2(buf + 6, static_cast<unsigned>(s));
+    dest.append(buf, buf + 8);
 }
 
 // return fraction of a second of the given time_point.
@@ -0,0 +1,138 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// gzip compression of closed log files (SPDLOG_USE_ZLIB must be defined, link with zlib).
+// Used by the rotating and daily file sinks to compress the rotated files from their
+// rotation_worker thread: log.1.txt -> log.1.txt.gz
+//
+// The file is compressed to <file>.gz.tmp, which is renamed to <file>.gz once complete, and
+// the original file is deleted. On any error (including a deflate error) the .tmp file is
+// removed and the original file is left as is.
+// To limit the CPU taken from the application, the compression sleeps between chunks so it
+// runs at most SPDLOG_ZLIB_CPU_PERCENT percent of the time.
+// Throw spdlog_ex exception on errors.
+
+#include "spdlog/common.h"
+#include "spdlog/details/os.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+#ifndef SPDLOG_ZLIB_CPU_PERCENT
+#define SPDLOG_ZLIB_CPU_PERCENT 25
+#endif
+
+namespace spdlog {
+namespace details {
+
+inline filename_t gzip_filename(const filename_t &filename)
+{
+    return filename + SPDLOG_FILENAME_T(".gz");
+}
+
+inline void gzip_file(const filename_t &filename, int cpu_percent = SPDLOG_ZLIB_CPU_PERCENT)
+{
+    static const size_t chunk_size = 64 * 1024;
+    filename_t gz_filename = gzip_filename(filename);
+    filename_t tmp_filename = gz_filename + SPDLOG_FILENAME_T(".tmp");
+
+    std::FILE *in = nullptr;
+    if (os::fopen_s(&in, filename, SPDLOG_FILENAME_T("rb")))
+    {
+        throw spdlog_ex("gzip_file: failed opening " + os::filename_to_str(filename), errno);
+    }
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> in_closer(in, std::fclose);
+
+    std::FILE *out = nullptr;
+    if (os::fopen_s(&out, tmp_filename, SPDLOG_FILENAME_T("wb")))
+    {
+        throw spdlog_ex("gzip_file: failed opening " + os::filename_to_str(tmp_filename), errno);
+    }
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> out_closer(out, std::fclose);
+
+    z_stream strm{};
+    // windowBits 15 + 16: gzip header and trailer
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw spdlog_ex("gzip_file: deflateInit2 failed");
+    }
+    std::unique_ptr<z_stream, int (*)(z_stream *)> strm_closer(&strm, deflateEnd);
+
+    auto fail = [&](const spdlog_ex &ex) {
+        out_closer.reset();
+        os::remove(tmp_filename);
+        throw ex;
+    };
+
+    std::vector<unsigned char> in_buf(chunk_size);
+    std::vector<unsigned char> out_buf(chunk_size);
+    int flush = Z_NO_FLUSH;
+    int ret = Z_OK;
+    while (flush != Z_FINISH)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        size_t n = std::fread(in_buf.data(), 1, in_buf.size(), in);
+        if (std::ferror(in))
+        {
+            fail(spdlog_ex("gzip_file: failed reading " + os::filename_to_str(filename), errno));
+        }
+        flush = std::feof(in) ? Z_FINISH : Z_NO_FLUSH;
+        strm.next_in = in_buf.data();
+        strm.avail_in = static_cast<uInt>(n);
+        do
+        {
+            strm.next_out = out_buf.data();
+            strm.avail_out = static_cast<uInt>(out_buf.size());
+            ret = deflate(&strm, flush);
+            // Z_BUF_ERROR means no progress was possible. it's expected only when the chunk was
+            // all consumed by the previous call (which filled the output exactly)
+            if (ret == Z_STREAM_ERROR || (ret == Z_BUF_ERROR && (flush == Z_FINISH || strm.avail_in != 0)))
+            {
+                fail(spdlog_ex("gzip_file: deflate failed (" + std::to_string(ret) + ") on " + os::filename_to_str(filename)));
+            }
+            size_t have = out_buf.size() - strm.avail_out;
+            if (have != 0 && std::fwrite(out_buf.data(), 1, have, out) != have)
+            {
+                fail(spdlog_ex("gzip_file: failed writing compressed " + os::filename_to_str(filename), errno));
+            }
+        } while (strm.avail_out == 0);
+
+        if (cpu_percent > 0 && cpu_percent < 100)
+        {
+            auto work = std::chrono::steady_clock::now() - start;
+            std::this_thread::sleep_for(work * (100 - cpu_percent) / cpu_percent);
+        }
+    }
+
+    if (ret != Z_STREAM_END)
+    {
+        fail(spdlog_ex("gzip_file: incomplete compressed stream for " + os::filename_to_str(filename)));
+    }
+    if (std::fflush(out) != 0)
+    {
+        fail(spdlog_ex("gzip_file: failed writing compressed " + os::filename_to_str(filename), errno));
+    }
+    out_closer.reset();
+    in_closer.reset();
+    if (os::rename(tmp_filename, gz_filename) != 0)
+    {
+        auto err = errno;
+        os::remove(tmp_filename);
+        throw spdlog_ex("gzip_file: failed renaming " + os::filename_to_str(tmp_filename), err);
+    }
+    os::remove(filename);
+}
+
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,245 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Hex encoding of byte buffers for bin_to_hex.h
+//
+// hex_encode(src, n, dest, upper, delimiter) writes 2 chars per byte, or 3 if a delimiter is
+// given (the delimiter first: " 0a 1b .."), and returns the end of the written text.
+// On x86-64 the kernel is picked on the first call, by the features of the cpu:
+// - no delimiter: AVX2 (32 bytes per step), or SSE2 (16 bytes per step)
+// - delimiter:    SSSE3 (16 bytes per step, the delimiters are inserted by pshufb)
+// and scalar otherwise (and for buffers shorter than a step). The tail of the buffer is
+// encoded by a last step overlapping the previous one.
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SPDLOG_HEX_X86_
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SPDLOG_HEX_TARGET_(isa)
+#else
+#define SPDLOG_HEX_TARGET_(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace spdlog {
+namespace details {
+
+using hex_encode_fn = char *(*)(const unsigned char *src, std::size_t n, char *dest, bool upper, char delimiter);
+
+// the two hex chars of each byte value
+struct hex_pairs_table
+{
+    char pairs[2][256][2]; // [upper][byte]
+
+    hex_pairs_table()
+    {
+        for (int upper = 0; upper < 2; upper++)
+        {
+            const char *hex_chars = upper != 0 ? "0123456789ABCDEF" : "0123456789abcdef";
+            for (int byte = 0; byte < 256; byte++)
+            {
+                pairs[upper][byte][0] = hex_chars[byte >> 4];
+                pairs[upper][byte][1] = hex_chars[byte & 0x0f];
+            }
+        }
+    }
+};
+
+inline char *hex_encode_scalar(const unsigned char *src, std::size_t n, char *dest, bool upper, char delimiter)
+{
+    static const hex_pairs_table table;
+    const char(*pairs)[2] = table.pairs[upper ? 1 : 0];
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (delimiter != '\0')
+        {
+            *dest++ = delimiter;
+        }
+        std::memcpy(dest, pairs[src[i]], 2);
+        dest += 2;
+    }
+    return dest;
+}
+
+#ifdef SPDLOG_HEX_X86_
+
+// the hex digits of the nibbles (0-15 per byte): '0' + n, plus the gap to 'a' (or 'A') if n > 9
+inline __m128i hex_digits_sse2_(__m128i nibbles, bool upper)
+{
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8(upper ? 'A' - '0' - 10 : 'a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+// hex chars of 16 bytes: the first 8 bytes in lo, the last 8 in hi
+inline void hex_pairs_sse2_(const unsigned char *src, bool upper, __m128i &lo, __m128i &hi)
+{
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i high_nibbles = hex_digits_sse2_(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask), upper);
+    __m128i low_nibbles = hex_digits_sse2_(_mm_and_si128(bytes, mask), upper);
+    lo = _mm_unpacklo_epi8(high_nibbles, low_nibbles);
+    hi = _mm_unpackhi_epi8(high_nibbles, low_nibbles);
+}
+
+inline char *hex_encode_sse2(const unsigned char *src, std::size_t n, char *dest, bool upper, char delimiter)
+{
+    if (delimiter != '\0' || n < 16)
+    {
+        return hex_encode_scalar(src, n, dest, upper, delimiter);
+    }
+    // the last block overlaps the previous one if n isn't a multiple of 16 (same chars written again)
+    for (std::size_t i = 0;; i += 16)
+    {
+        if (i + 16 > n)
+        {
+            i = n - 16;
+        }
+        __m128i lo, hi;
+        hex_pairs_sse2_(src + i, upper, lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2 + 16), hi);
+        if (i + 16 == n)
+        {
+            return dest + n * 2;
+        }
+    }
+}
+
+SPDLOG_HEX_TARGET_("ssse3")
+inline char *hex_encode_ssse3(const unsigned char *src, std::size_t n, char *dest, bool upper, char delimiter)
+{
+    if (delimiter == '\0' || n < 16)
+    {
+        return delimiter == '\0' ? hex_encode_sse2(src, n, dest, upper, delimiter) : hex_encode_scalar(src, n, dest, upper, delimiter);
+    }
+    // 16 bytes -> 48 chars: "DhlDhl..". -1 (0x80) picks zero, which the delimiter fills
+    const __m128i from_lo0 = _mm_setr_epi8(-1, 0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1);
+    const __m128i from_lo1 = _mm_setr_epi8(10, 11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i from_hi1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, -1, 2, 3, -1, 4);
+    const __m128i from_hi2 = _mm_setr_epi8(5, -1, 6, 7, -1, 8, 9, -1, 10, 11, -1, 12, 13, -1, 14, 15);
+    const __m128i delimiters0 = _mm_and_si128(_mm_cmpeq_epi8(from_lo0, _mm_set1_epi8(-1)), _mm_set1_epi8(delimiter));
+    const __m128i delimiters1 =
+        _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(from_lo1, from_hi1), _mm_set1_epi8(-1)), _mm_set1_epi8(delimiter));
+    const __m128i delimiters2 = _mm_and_si128(_mm_cmpeq_epi8(from_hi2, _mm_set1_epi8(-1)), _mm_set1_epi8(delimiter));
+    for (std::size_t i = 0;; i += 16)
+    {
+        if (i + 16 > n)
+        {
+            i = n - 16; // overlapping last block
+        }
+        __m128i lo, hi;
+        hex_pairs_sse2_(src + i, upper, lo, hi);
+        __m128i out0 = _mm_or_si128(_mm_shuffle_epi8(lo, from_lo0), delimiters0);
+        __m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(lo, from_lo1), _mm_shuffle_epi8(hi, from_hi1)), delimiters1);
+        __m128i out2 = _mm_or_si128(_mm_shuffle_epi8(hi, from_hi2), delimiters2);
+        char *block_dest = dest + i * 3;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(block_dest), out0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(block_dest + 16), out1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(block_dest + 32), out2);
+        if (i + 16 == n)
+        {
+            return dest + n * 3;
+        }
+    }
+}
+
+SPDLOG_HEX_TARGET_("avx2")
+inline char *hex_encode_avx2(const unsigned char *src, std::size_t n, char *dest, bool upper, char delimiter)
+{
+    if (delimiter != '\0' || n < 32)
+    {
+        return delimiter != '\0' ? hex_encode_ssse3(src, n, dest, upper, delimiter) : hex_encode_sse2(src, n, dest, upper, delimiter);
+    }
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i zero_char = _mm256_set1_epi8('0');
+    const __m256i gap = _mm256_set1_epi8(upper ? 'A' - '0' - 10 : 'a' - '0' - 10);
+    for (std::size_t i = 0;; i += 32)
+    {
+        if (i + 32 > n)
+        {
+            i = n - 32; // overlapping last block
+        }
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask);
+        __m256i low_nibbles = _mm256_and_si256(bytes, mask);
+        high_nibbles = _mm256_add_epi8(_mm256_add_epi8(high_nibbles, zero_char), _mm256_and_si256(_mm256_cmpgt_epi8(high_nibbles, nine), gap));
+        low_nibbles = _mm256_add_epi8(_mm256_add_epi8(low_nibbles, zero_char), _mm256_and_si256(_mm256_cmpgt_epi8(low_nibbles, nine), gap));
+        // the unpacks work per 128 bit lane: lo = bytes 0-7 | 16-23, hi = bytes 8-15 | 24-31
+        __m256i lo = _mm256_unpacklo_epi8(high_nibbles, low_nibbles);
+        __m256i hi = _mm256_unpackhi_epi8(high_nibbles, low_nibbles);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 2 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+        if (i + 32 == n)
+        {
+            return dest + n * 2;
+        }
+    }
+}
+
+struct hex_cpu_features
+{
+    bool ssse3{false};
+    bool avx2{false};
+
+    hex_cpu_features()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+        __cpuid(info, 1);
+        ssse3 = (info[2] & (1 << 9)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (max_leaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6) // the os saves the ymm registers
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        ssse3 = __builtin_cpu_supports("ssse3") != 0;
+        avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+};
+
+inline hex_encode_fn select_hex_encode_()
+{
+    hex_cpu_features cpu;
+    if (cpu.avx2)
+    {
+        return hex_encode_avx2;
+    }
+    if (cpu.ssse3)
+    {
+        return hex_encode_ssse3;
+    }
+    return hex_encode_sse2;
+}
+
+#else // not x86-64
+
+inline hex_encode_fn select_hex_encode_()
+{
+    return hex_encode_scalar;
+}
+
+#endif
+
+inline char *hex_encode(const unsigned char *src, std::size_t n, char *dest, bool upper, char delimiter)
+{
+    static const hex_encode_fn encode = select_hex_encode_();
+    return encode(src, n, dest, upper, delimiter);
+}
+
+} // namespace details
+} // namespace spdlog
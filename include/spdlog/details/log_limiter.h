@@ -0,0 +1,128 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Call site limiters of the log calls (see SPDLOG_LOGGER_RATE_LIMITED and SPDLOG_LOGGER_SAMPLED):
+//
+// rate_limiter - token bucket of `burst` tokens refilled at `rate_per_sec`, implemented as GCRA:
+//                each call let through moves the theoretical arrival time (tat) one emission
+//                interval (1s / rate) forward. a call is let through while the tat is less than
+//                `burst` intervals ahead of now. one CAS per call let through, a load and a
+//                counter increment per suppressed call.
+//                the suppressed calls are counted, and the count is taken (and reset) by the next
+//                call let through, which logger::log_limited precedes by a
+//                "suppressed N similar messages" line. if the call site stops firing, the
+//                logger takes the count on its next flush() (the first suppressed call of a
+//                burst registers the limiter with it), so the summary of the last burst is not
+//                lost: spdlog::flush_every(...) bounds how late it comes.
+// log_sampler  - lets the first of every n calls through (one fetch_add per call). no summary: the
+//                calls between two messages are the n - 1 suppressed ones.
+
+#include "spdlog/common.h"
+#include "spdlog/details/os.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace spdlog {
+namespace details {
+
+class rate_limiter
+{
+public:
+    rate_limiter(double rate_per_sec, std::size_t burst)
+        : interval_ns_(rate_per_sec > 0 ? static_cast<long long>(1e9 / rate_per_sec) : 0)
+        , tolerance_ns_(interval_ns_ * static_cast<long long>(burst > 0 ? burst - 1 : 0))
+    {
+        if (rate_per_sec <= 0 || burst == 0)
+        {
+            throw spdlog_ex("rate_limiter: the rate and the burst must be positive");
+        }
+    }
+
+    rate_limiter(const rate_limiter &) = delete;
+    rate_limiter &operator=(const rate_limiter &) = delete;
+
+    // true if the call may log. suppressed is set to the number of calls suppressed since the
+    // previous one let through (or since take_suppressed), this one included if it is suppressed
+    bool allow(std::size_t &suppressed) SPDLOG_NOEXCEPT
+    {
+        auto now = now_ns_();
+        auto tat = tat_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto base = tat > now ? tat : now;
+            if (base - now > tolerance_ns_)
+            {
+                suppressed = suppressed_.fetch_add(1, std::memory_order_relaxed) + 1;
+                return false;
+            }
+            if (tat_.compare_exchange_weak(tat, base + interval_ns_, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        suppressed = take_suppressed();
+        return true;
+    }
+
+    // take (and reset) the count of the suppressed calls not reported yet
+    std::size_t take_suppressed() SPDLOG_NOEXCEPT
+    {
+        return suppressed_.load(std::memory_order_relaxed) != 0 ? suppressed_.exchange(0, std::memory_order_relaxed) : 0;
+    }
+
+private:
+    // coarse monotonic clock (ms resolution or so, good enough for the log rates, and several
+    // times cheaper than steady_clock)
+    static long long now_ns_() SPDLOG_NOEXCEPT
+    {
+#if defined(__linux__)
+        timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#elif defined(_WIN32)
+        return static_cast<long long>(::GetTickCount64()) * 1000000LL;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    const long long interval_ns_;
+    const long long tolerance_ns_;
+    std::atomic<long long> tat_{0};
+    std::atomic<std::size_t> suppressed_{0};
+};
+
+class log_sampler
+{
+public:
+    explicit log_sampler(std::size_t n)
+        : n_(n)
+    {
+        if (n_ == 0)
+        {
+            throw spdlog_ex("log_sampler: n must be positive");
+        }
+    }
+
+    log_sampler(const log_sampler &) = delete;
+    log_sampler &operator=(const log_sampler &) = delete;
+
+    bool allow(std::size_t &suppressed) SPDLOG_NOEXCEPT
+    {
+        suppressed = 0;
+        return calls_.fetch_add(1, std::memory_order_relaxed) % n_ == 0;
+    }
+
+private:
+    const std::size_t n_;
+    std::atomic<std::size_t> calls_{0};
+};
+
+} // namespace details
+} // namespace spdlog
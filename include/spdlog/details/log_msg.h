@@ -6,28 +6,50 @@
 #pragma once
 
 #include "spdlog/common.h"
+#include "spdlog/details/clock.h"
 #include "spdlog/details/os.h"
 
+#include <cstdint>
 #include <string>
 #include <utility>
 
 namespace spdlog {
 namespace details {
+struct deferred_format_info;
+
 struct log_msg
 {
     log_msg() = default;
 
-    log_msg(const std::string *loggers_name, level::level_enum lvl, string_view_t view)
+    log_msg(const std::string *loggers_name, level::level_enum lvl, string_view_t view, clock_policy clock = clock_policy::system)
         : logger_name(loggers_name)
         , level(lvl)
-#ifndef SPDLOG_NO_DATETIME
-        , time(os::now())
-#endif
-
 #ifndef SPDLOG_NO_THREAD_ID
         , thread_id(os::thread_id())
+#endif
         , payload(view)
+    {
+#ifndef SPDLOG_NO_DATETIME
+        if (clock == clock_policy::tsc)
+        {
+            clock_ticks = tsc_clock::ticks();
+        }
+        else
+        {
+            time = clock_now(clock);
+        }
+#else
+        (void)clock;
 #endif
+    }
+
+    // with the given time and thread id (messages coming from the async queue)
+    log_msg(const std::string *loggers_name, level::level_enum lvl, string_view_t view, log_clock::time_point msg_time, size_t msg_thread_id)
+        : logger_name(loggers_name)
+        , level(lvl)
+        , time(msg_time)
+        , thread_id(msg_thread_id)
+        , payload(view)
     {
     }
 
@@ -37,14 +59,32 @@ struct log_msg
     const std::string *logger_name{nullptr};
     level::level_enum level{level::off};
     log_clock::time_point time;
+    // cpu ticks of the message if the logger uses clock_policy::tsc (0 otherwise).
+    // the time is computed from them (by resolve_time()) before the sinks get the message.
+    std::uint64_t clock_ticks{0};
     size_t thread_id{0};
-    size_t msg_id;
+    size_t msg_id{0};
 
     // info about wrapping the formatted text with color (updated by pattern_formatter).
     mutable size_t color_range_start{0};
     mutable size_t color_range_end{0};
 
     const string_view_t payload;
+
+    // deferred formatting (async loggers only): the arguments captured by the caller, formatted
+    // with deferred_fmt by the thread pool. the sinks get the formatted payload and the arguments.
+    const char *deferred_fmt{nullptr};
+    const deferred_format_info *deferred_info{nullptr};
+    string_view_t deferred_args;
+
+    void resolve_time()
+    {
+        if (clock_ticks != 0)
+        {
+            time = tsc_clock::to_time_point(clock_ticks);
+            clock_ticks = 0;
+        }
+    }
 };
 } // namespace details
 } // namespace spdlog
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "spdlog/details/deferred_args.h"
 #include "spdlog/details/fmt_helper.h"
 
 #include <memory>
@@ -63,10 +64,16 @@ inline void spdlog::logger::log(level::level_enum lvl, const char *fmt, const Ar
 
     try
     {
+        if (deferred_formatting_ &&
+            log_deferred_(std::integral_constant<bool, sizeof...(Args) != 0 && details::deferred_args<Args...>::value>(), lvl, fmt, args...))
+        {
+            return;
+        }
+
         using details::fmt_helper::to_string_view;
         typename fmt::memory_buffer buf;
         fmt::format_to(buf, fmt, args...);
-        details::log_msg log_msg(&name_, lvl, to_string_view(buf));
+        details::log_msg log_msg(&name_, lvl, to_string_view(buf), clock_.load(std::memory_order_relaxed));
         sink_it_(log_msg);
     }
     SPDLOG_CATCH_AND_HANDLE
@@ -81,7 +88,7 @@ inline void spdlog::logger::log(level::level_enum lvl, const char *msg)
 
     try
     {
-        details::log_msg log_msg(&name_, lvl, spdlog::string_view_t(msg));
+        details::log_msg log_msg(&name_, lvl, spdlog::string_view_t(msg), clock_.load(std::memory_order_relaxed));
         sink_it_(log_msg);
     }
     SPDLOG_CATCH_AND_HANDLE
@@ -96,7 +103,7 @@ inline void spdlog::logger::log(level::level_enum lvl, const T &msg)
     }
     try
     {
-        details::log_msg log_msg(&name_, lvl, static_cast<spdlog::string_view_t>(msg));
+        details::log_msg log_msg(&name_, lvl, static_cast<spdlog::string_view_t>(msg), clock_.load(std::memory_order_relaxed));
         sink_it_(log_msg);
     }
     SPDLOG_CATCH_AND_HANDLE
@@ -114,12 +121,32 @@ inline void spdlog::logger::log(level::level_enum lvl, const T &msg)
         using details::fmt_helper::to_string_view;
         fmt::memory_buffer buf;
         fmt::format_to(buf, "{}", msg);
-        details::log_msg log_msg(&name_, lvl, to_string_view(buf));
+        details::log_msg log_msg(&name_, lvl, to_string_view(buf), clock_.load(std::memory_order_relaxed));
         sink_it_(log_msg);
     }
     SPDLOG_CATCH_AND_HANDLE
 }
 
+template<typename... Args>
+inline bool spdlog::logger::log_deferred_(std::true_type, level::level_enum lvl, const char *fmt, const Args &... args)
+{
+    using captured = details::deferred_args<Args...>;
+    char buf[captured::size];
+    captured::write(buf, args...);
+    details::log_msg log_msg(&name_, lvl, spdlog::string_view_t(), clock_.load(std::memory_order_relaxed));
+    log_msg.deferred_fmt = fmt;
+    log_msg.deferred_info = &captured::info;
+    log_msg.deferred_args = spdlog::string_view_t(buf, captured::size);
+    sink_it_(log_msg);
+    return true;
+}
+
+template<typename... Args>
+inline bool spdlog::logger::log_deferred_(std::false_type, level::level_enum, const char *, const Args &...)
+{
+    return false;
+}
+
 template<typename... Args>
 inline void spdlog::logger::trace(const char *fmt, const Args &... args)
 {
@@ -192,6 +219,31 @@ inline void spdlog::logger::critical(const T &msg)
     log(level::critical, msg);
 }
 
+template<typename Limiter, typename... Args>
+inline void spdlog::logger::log_limited(Limiter &limiter, level::level_enum lvl, const char *fmt, const Args &... args)
+{
+    size_t suppressed = 0;
+    if (!should_log(lvl))
+    {
+        return;
+    }
+    if (!limiter.allow(suppressed))
+    {
+        // first suppressed call of a burst: have the summary logged by flush() if the call site
+        // lets nothing through until then
+        if (suppressed == 1)
+        {
+            on_suppressed_(limiter, lvl);
+        }
+        return;
+    }
+    if (suppressed != 0)
+    {
+        log(lvl, "suppressed {} similar messages", suppressed);
+    }
+    log(lvl, fmt, args...);
+}
+
 #ifdef SPDLOG_WCHAR_TO_UTF8_SUPPORT
 
 inline void wbuf_to_utf8buf(const fmt::wmemory_buffer &wbuf, fmt::memory_buffer &target)
@@ -231,7 +283,7 @@ inline void spdlog::logger::log(level::level_enum lvl, const wchar_t *fmt, const
         fmt::format_to(wbuf, fmt, args...);
         fmt::memory_buffer buf;
         wbuf_to_utf8buf(wbuf, buf);
-        details::log_msg log_msg(&name_, lvl, to_string_view(buf));
+        details::log_msg log_msg(&name_, lvl, to_string_view(buf), clock_.load(std::memory_order_relaxed));
         sink_it_(log_msg);
     }
     SPDLOG_CATCH_AND_HANDLE
@@ -298,8 +350,41 @@ inline spdlog::log_err_handler spdlog::logger::error_handler() const
     return err_handler_;
 }
 
+inline void spdlog::logger::set_clock(clock_policy clock)
+{
+    // start the ticker thread / calibrate the ticks now, rather than on the first message
+    if (clock == clock_policy::cached)
+    {
+        details::cached_clock::instance();
+    }
+    else if (clock == clock_policy::tsc)
+    {
+        details::tsc_clock::instance();
+    }
+    clock_.store(clock, std::memory_order_relaxed);
+}
+
+inline spdlog::clock_policy spdlog::logger::clock() const
+{
+    return clock_.load(std::memory_order_relaxed);
+}
+
+inline void spdlog::logger::report_suppressed_on_flush(details::rate_limiter &limiter, level::level_enum lvl)
+{
+    std::lock_guard<std::mutex> lock(suppressed_mutex_);
+    for (auto &pending : suppressed_limiters_)
+    {
+        if (pending.first == &limiter)
+        {
+            return;
+        }
+    }
+    suppressed_limiters_.emplace_back(&limiter, lvl);
+}
+
 inline void spdlog::logger::flush()
 {
+    log_suppressed_();
     try
     {
         flush_();
@@ -317,6 +402,32 @@ inline spdlog::level::level_enum spdlog::logger::flush_level() const
     return static_cast<spdlog::level::level_enum>(flush_level_.load(std::memory_order_relaxed));
 }
 
+inline void spdlog::logger::on_suppressed_(details::rate_limiter &limiter, level::level_enum lvl)
+{
+    report_suppressed_on_flush(limiter, lvl);
+}
+
+inline void spdlog::logger::log_suppressed_()
+{
+    std::vector<std::pair<details::rate_limiter *, level::level_enum>> pending;
+    {
+        std::lock_guard<std::mutex> lock(suppressed_mutex_);
+        if (suppressed_limiters_.empty())
+        {
+            return;
+        }
+        pending.swap(suppressed_limiters_);
+    }
+    for (auto &limiter : pending)
+    {
+        auto suppressed = limiter.first->take_suppressed();
+        if (suppressed != 0)
+        {
+            log(limiter.second, "suppressed {} similar messages", suppressed);
+        }
+    }
+}
+
 inline bool spdlog::logger::should_flush_(const details::log_msg &msg)
 {
     auto flush_level = flush_level_.load(std::memory_order_relaxed);
@@ -342,6 +453,7 @@ inline void spdlog::logger::sink_it_(details::log_msg &msg)
 #if defined(SPDLOG_ENABLE_MESSAGE_COUNTER)
     incr_msg_counter_(msg);
 #endif
+    msg.resolve_time();
     for (auto &sink : sinks_)
     {
         if (sink->should_log(msg.level))
@@ -399,5 +511,6 @@ inline std::shared_ptr<spdlog::logger> spdlog::logger::clone(std::string logger_
     cloned->set_level(this->level());
     cloned->flush_on(this->flush_level());
     cloned->set_error_handler(this->error_handler());
+    cloned->set_clock(this->clock());
     return cloned;
 }
@@ -0,0 +1,422 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Helper class for memory mapped file sinks.
+// The file is preallocated in extents (64 MiB by default) and the records are copied straight
+// into the mapping of the current extent. When the extent is full the next one is
+// preallocated and mapped.
+// On close the file is truncated to the written length. If the process crashed before,
+// the trailing zeros of the last extent are skipped when the file is reopened for append.
+// Throw spdlog_ex exception on errors.
+
+#include "spdlog/common.h"
+#include "spdlog/details/os.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog {
+
+// what flush() does on memory mapped files
+enum class mmap_flush_policy
+{
+    none,  // nothing, the kernel writes the pages back on its own (enough to survive a process crash)
+    async, // start writing back the dirty pages (msync MS_ASYNC)
+    sync   // write back the dirty pages and wait for completion (msync MS_SYNC)
+};
+
+namespace details {
+
+class mmap_file
+{
+public:
+    static const size_t default_extent_size = 64 * 1024 * 1024;
+
+    explicit mmap_file(mmap_flush_policy flush_policy = mmap_flush_policy::none, size_t extent_size = default_extent_size)
+        : flush_policy_(flush_policy)
+        , extent_size_(round_up_(std::max(extent_size, granularity_()), granularity_()))
+    {
+    }
+
+    mmap_file(const mmap_file &) = delete;
+    mmap_file &operator=(const mmap_file &) = delete;
+
+    ~mmap_file()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void open(const filename_t &fname, bool truncate = false)
+    {
+        close();
+        filename_ = fname;
+        open_handle_(truncate);
+        file_size_ = handle_size_();
+        length_ = file_size_;
+        flushed_ = file_size_;
+        if (length_ != 0)
+        {
+            skip_trailing_zeros_();
+            flushed_ = length_;
+        }
+        map_(round_down_(length_, extent_size_));
+    }
+
+    void write(const fmt::memory_buffer &buf)
+    {
+        write(buf.data(), buf.size());
+    }
+
+    void write(const char *data, size_t size)
+    {
+        if (map_ptr_ == nullptr)
+        {
+            throw spdlog_ex("Failed writing to closed file " + os::filename_to_str(filename_));
+        }
+        while (size != 0)
+        {
+            if (length_ == map_offset_ + extent_size_)
+            {
+                map_(length_);
+            }
+            size_t n = std::min(size, map_offset_ + extent_size_ - length_);
+            std::memcpy(map_ptr_ + (length_ - map_offset_), data, n);
+            length_ += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    // write back the pages written since the last flush, according to the flush policy
+    void flush()
+    {
+        if (map_ptr_ == nullptr || flush_policy_ == mmap_flush_policy::none || flushed_ >= length_)
+        {
+            return;
+        }
+        size_t start = round_down_(std::max(flushed_, map_offset_), page_size_());
+        sync_range_(map_ptr_ + (start - map_offset_), length_ - start, flush_policy_ == mmap_flush_policy::sync);
+        flushed_ = length_;
+    }
+
+    // unmap and truncate the file to the written length
+    void close()
+    {
+        if (!handle_open_())
+        {
+            return;
+        }
+        unmap_();
+        truncate_handle_(length_);
+        close_handle_();
+    }
+
+    // written length
+    size_t size() const
+    {
+        return length_;
+    }
+
+    const filename_t &filename() const
+    {
+        return filename_;
+    }
+
+private:
+    static size_t round_down_(size_t n, size_t unit)
+    {
+        return n - n % unit;
+    }
+
+    static size_t round_up_(size_t n, size_t unit)
+    {
+        return round_down_(n + unit - 1, unit);
+    }
+
+    static size_t page_size_()
+    {
+#ifdef _WIN32
+        return 4096; // FlushViewOfFile rounds down to page boundaries by itself
+#else
+        static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return page_size;
+#endif
+    }
+
+    // the map offsets (and so the extents) must be multiples of it
+    static size_t granularity_()
+    {
+#ifdef _WIN32
+        return 64 * 1024; // allocation granularity of MapViewOfFile
+#else
+        return page_size_(); // 4K, but 16K or 64K on some arm64 and ppc64le systems
+#endif
+    }
+
+    // the process crashed before the file was truncated: find the end of the written data
+    void skip_trailing_zeros_()
+    {
+        while (length_ != 0)
+        {
+            map_(round_down_(length_ - 1, extent_size_));
+            while (length_ > map_offset_ && map_ptr_[length_ - 1 - map_offset_] == 0)
+            {
+                --length_;
+            }
+            if (length_ != map_offset_)
+            {
+                break;
+            }
+        }
+    }
+
+    // map the extent starting at offset, preallocating it if needed
+    void map_(size_t offset)
+    {
+        unmap_();
+        if (offset + extent_size_ > file_size_)
+        {
+            preallocate_(offset + extent_size_);
+            file_size_ = offset + extent_size_;
+        }
+        map_handle_(offset);
+        map_offset_ = offset;
+    }
+
+    void unmap_()
+    {
+        if (map_ptr_ == nullptr)
+        {
+            return;
+        }
+        // the pages of the extent are not reachable by flush() anymore
+        if (flush_policy_ != mmap_flush_policy::none && flushed_ < length_)
+        {
+            size_t start = round_down_(std::max(flushed_, map_offset_), page_size_());
+            size_t end = std::min(length_, map_offset_ + extent_size_);
+            if (start < end)
+            {
+                sync_range_(map_ptr_ + (start - map_offset_), end - start, flush_policy_ == mmap_flush_policy::sync);
+            }
+            flushed_ = end;
+        }
+        unmap_handle_();
+        map_ptr_ = nullptr;
+    }
+
+#ifdef _WIN32
+    void open_handle_(bool truncate)
+    {
+        DWORD disposition = truncate ? CREATE_ALWAYS : OPEN_ALWAYS;
+        DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+#ifdef SPDLOG_WCHAR_FILENAMES
+        file_ = ::CreateFileW(filename_.c_str(), GENERIC_READ | GENERIC_WRITE, share, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+        file_ = ::CreateFileA(filename_.c_str(), GENERIC_READ | GENERIC_WRITE, share, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+#endif
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            throw spdlog_ex("Failed opening file " + os::filename_to_str(filename_) + " for writing", static_cast<int>(::GetLastError()));
+        }
+    }
+
+    size_t handle_size_()
+    {
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file_, &size))
+        {
+            throw spdlog_ex("Failed getting file size of " + os::filename_to_str(filename_), static_cast<int>(::GetLastError()));
+        }
+        return static_cast<size_t>(size.QuadPart);
+    }
+
+    void preallocate_(size_t size)
+    {
+        // the file is extended by CreateFileMapping
+        (void)size;
+    }
+
+    void map_handle_(size_t offset)
+    {
+        unsigned long long end = offset + extent_size_;
+        mapping_ = ::CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), nullptr);
+        if (mapping_ == nullptr)
+        {
+            throw spdlog_ex("Failed mapping file " + os::filename_to_str(filename_), static_cast<int>(::GetLastError()));
+        }
+        unsigned long long off = offset;
+        map_ptr_ = static_cast<char *>(
+            ::MapViewOfFile(mapping_, FILE_MAP_WRITE, static_cast<DWORD>(off >> 32), static_cast<DWORD>(off), extent_size_));
+        if (map_ptr_ == nullptr)
+        {
+            auto err = static_cast<int>(::GetLastError());
+            ::CloseHandle(mapping_);
+            mapping_ = nullptr;
+            throw spdlog_ex("Failed mapping file " + os::filename_to_str(filename_), err);
+        }
+    }
+
+    void unmap_handle_()
+    {
+        ::UnmapViewOfFile(map_ptr_);
+        ::CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+
+    void sync_range_(char *addr, size_t size, bool wait)
+    {
+        ::FlushViewOfFile(addr, size);
+        if (wait)
+        {
+            ::FlushFileBuffers(file_);
+        }
+    }
+
+    void truncate_handle_(size_t size)
+    {
+        LARGE_INTEGER pos;
+        pos.QuadPart = static_cast<LONGLONG>(size);
+        if (!::SetFilePointerEx(file_, pos, nullptr, FILE_BEGIN) || !::SetEndOfFile(file_))
+        {
+            auto err = static_cast<int>(::GetLastError());
+            close_handle_();
+            throw spdlog_ex("Failed truncating file " + os::filename_to_str(filename_), err);
+        }
+    }
+
+    void close_handle_()
+    {
+        ::CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+
+    bool handle_open_() const
+    {
+        return file_ != INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    void open_handle_(bool truncate)
+    {
+        int flags = O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0);
+#ifdef O_CLOEXEC
+        flags |= O_CLOEXEC;
+#endif
+        fd_ = ::open(filename_.c_str(), flags, 0644);
+        if (fd_ == -1)
+        {
+            throw spdlog_ex("Failed opening file " + os::filename_to_str(filename_) + " for writing", errno);
+        }
+    }
+
+    size_t handle_size_()
+    {
+        struct stat st;
+        if (::fstat(fd_, &st) != 0)
+        {
+            throw spdlog_ex("Failed getting file size of " + os::filename_to_str(filename_), errno);
+        }
+        return static_cast<size_t>(st.st_size);
+    }
+
+    // reserve the disk blocks, so writing to the mapping can't fail (SIGBUS) on a full disk
+    void preallocate_(size_t size)
+    {
+#ifdef __linux__
+        int rv = ::posix_fallocate(fd_, static_cast<off_t>(file_size_), static_cast<off_t>(size - file_size_));
+        if (rv == 0)
+        {
+            return;
+        }
+        if (rv != EOPNOTSUPP && rv != EINVAL)
+        {
+            throw spdlog_ex("Failed preallocating file " + os::filename_to_str(filename_), rv);
+        }
+#endif
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+        {
+            throw spdlog_ex("Failed preallocating file " + os::filename_to_str(filename_), errno);
+        }
+    }
+
+    void map_handle_(size_t offset)
+    {
+        void *addr = ::mmap(nullptr, extent_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+        if (addr == MAP_FAILED)
+        {
+            throw spdlog_ex("Failed mapping file " + os::filename_to_str(filename_), errno);
+        }
+        map_ptr_ = static_cast<char *>(addr);
+    }
+
+    void unmap_handle_()
+    {
+        ::munmap(map_ptr_, extent_size_);
+    }
+
+    void sync_range_(char *addr, size_t size, bool wait)
+    {
+        ::msync(addr, size, wait ? MS_SYNC : MS_ASYNC);
+    }
+
+    void truncate_handle_(size_t size)
+    {
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+        {
+            auto err = errno;
+            close_handle_();
+            throw spdlog_ex("Failed truncating file " + os::filename_to_str(filename_), err);
+        }
+        if (flush_policy_ == mmap_flush_policy::sync)
+        {
+            ::fsync(fd_);
+        }
+    }
+
+    void close_handle_()
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool handle_open_() const
+    {
+        return fd_ != -1;
+    }
+
+    int fd_ = -1;
+#endif
+
+    const mmap_flush_policy flush_policy_;
+    const size_t extent_size_;
+    filename_t filename_;
+
+    char *map_ptr_ = nullptr;
+    size_t map_offset_ = 0; // file offset of the mapped extent
+    size_t file_size_ = 0;  // preallocated size
+    size_t length_ = 0;     // written length
+    size_t flushed_ = 0;    // length written back according to the flush policy
+};
+} // namespace details
+} // namespace spdlog
@@ -9,8 +9,11 @@
 // enqueue(..) - will block until room found to put the new message.
 // enqueue_nowait(..) - will return immediately with false if no room left in
 // the queue.
+// try_enqueue(..) - will return false (leaving the queue untouched) if no room left.
 // dequeue_for(..) - will block until the queue is not empty or timeout have
 // passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but moves out up to max_items
+// messages under a single lock.
 
 #include "spdlog/details/circular_q.h"
 
@@ -52,6 +55,21 @@ public:
         push_cv_.notify_one();
     }
 
+    // enqueue immediately. return false if no room left.
+    bool try_enqueue(T &&item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (q_.full())
+            {
+                return false;
+            }
+            q_.push_back(std::move(item));
+        }
+        push_cv_.notify_one();
+        return true;
+    }
+
     // try to dequeue item. if no item found. wait upto timeout and try again
     // Return true, if succeeded dequeue item, false otherwise
     bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
@@ -68,6 +86,27 @@ public:
         return true;
     }
 
+    // try to dequeue up to max_items under a single lock. if no item found. wait upto timeout and
+    // try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (!push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); }))
+            {
+                return 0;
+            }
+            while (count < max_items && !q_.empty())
+            {
+                q_.pop_front(popped_items[count++]);
+            }
+        }
+        pop_cv_.notify_all();
+        return count;
+    }
+
 #else
     // apparently mingw deadlocks if the mutex is released before cv.notify_one(),
     // so release the mutex at the very end each function.
@@ -89,6 +128,19 @@ public:
         push_cv_.notify_one();
     }
 
+    // enqueue immediately. return false if no room left.
+    bool try_enqueue(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (q_.full())
+        {
+            return false;
+        }
+        q_.push_back(std::move(item));
+        push_cv_.notify_one();
+        return true;
+    }
+
     // try to dequeue item. if no item found. wait upto timeout and try again
     // Return true, if succeeded dequeue item, false otherwise
     bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
@@ -103,6 +155,25 @@ public:
         return true;
     }
 
+    // try to dequeue up to max_items under a single lock. if no item found. wait upto timeout and
+    // try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (!push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); }))
+        {
+            return 0;
+        }
+        size_t count = 0;
+        while (count < max_items && !q_.empty())
+        {
+            q_.pop_front(popped_items[count++]);
+        }
+        pop_cv_.notify_all();
+        return count;
+    }
+
 #endif
 
     size_t overrun_counter()
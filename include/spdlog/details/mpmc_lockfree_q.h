@@ -0,0 +1,232 @@
+#pragma once
+
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// multi producer-multi consumer lock-free bounded queue.
+// based on per-slot sequence numbers (see Dmitry Vyukov's bounded mpmc queue).
+// drop-in replacement for mpmc_blocking_queue (define SPDLOG_LOCKFREE_QUEUE in tweakme.h).
+//
+// enqueue(..) - will spin (and yield) until room found to put the new message.
+// enqueue_nowait(..) - will overrun the oldest message in the queue if no room left.
+// dequeue_for(..) - will park the consumer until the queue is not empty or timeout have
+// passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but moves out up to max_items messages.
+//
+// producers never take a lock. the mutex/condition variable pair is only used to park
+// consumers while the queue is empty, and producers touch it only if a consumer sleeps.
+// the capacity is rounded up to the next power of two.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace spdlog {
+namespace details {
+
+template<typename T>
+class mpmc_lockfree_queue
+{
+public:
+    using item_type = T;
+    explicit mpmc_lockfree_queue(size_t max_items)
+        : mask_(round_up_pow2_(max_items) - 1)
+        , buffer_(new cell[mask_ + 1])
+    {
+        for (size_t i = 0; i <= mask_; i++)
+        {
+            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpmc_lockfree_queue(const mpmc_lockfree_queue &) = delete;
+    mpmc_lockfree_queue &operator=(const mpmc_lockfree_queue &) = delete;
+
+    // try to enqueue and spin if no room left
+    void enqueue(T &&item)
+    {
+        for (unsigned spins = 0; !try_enqueue(std::move(item)); ++spins)
+        {
+            backoff_(spins);
+        }
+    }
+
+    // enqueue immediately. overrun oldest message in the queue if no room left.
+    void enqueue_nowait(T &&item)
+    {
+        while (!try_enqueue(std::move(item)))
+        {
+            T discarded;
+            if (try_dequeue(discarded))
+            {
+                overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // try to dequeue item. if no item found. wait upto timeout and try again
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        if (try_dequeue(popped_item))
+        {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool dequeued = park_cv_.wait_for(lock, wait_duration, [&] { return this->try_dequeue(popped_item); });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return dequeued;
+    }
+
+    // try to dequeue up to max_items. if no item found. wait upto timeout and try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        if (max_items == 0 || !dequeue_for(popped_items[0], wait_duration))
+        {
+            return 0;
+        }
+        size_t count = 1;
+        while (count < max_items && try_dequeue(popped_items[count]))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    // enqueue without waiting. return false (and leave item untouched) if the queue is full.
+    bool try_enqueue(T &&item)
+    {
+        cell *target;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            target = &buffer_[pos & mask_];
+            size_t seq = target->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        target->data = std::move(item);
+        target->sequence.store(pos + 1, std::memory_order_release);
+        wake_consumer_();
+        return true;
+    }
+
+    // dequeue without waiting. return false if the queue is empty.
+    bool try_dequeue(T &popped_item)
+    {
+        cell *target;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            target = &buffer_[pos & mask_];
+            size_t seq = target->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                // acq_rel: consumers that dequeue later see what earlier consumers did before
+                // their dequeue (the thread pool relies on it to reclaim loggers)
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        popped_item = std::move(target->data);
+        target->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t overrun_counter()
+    {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const size_t cacheline_size = 64;
+
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t round_up_pow2_(size_t n)
+    {
+        size_t pow2 = 2;
+        while (pow2 < n)
+        {
+            pow2 <<= 1;
+        }
+        return pow2;
+    }
+
+    static void backoff_(unsigned spins)
+    {
+        if (spins > 16)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // wake a parked consumer (if any) after publishing a new item
+    void wake_consumer_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) != 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(park_mutex_);
+            }
+            park_cv_.notify_one();
+        }
+    }
+
+    const size_t mask_;
+    std::unique_ptr<cell[]> buffer_;
+
+    // keep the hot indices on separate cache lines
+    char pad0_[cacheline_size];
+    std::atomic<size_t> enqueue_pos_{0};
+    char pad1_[cacheline_size - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_{0};
+    char pad2_[cacheline_size - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> sleepers_{0};
+    std::atomic<size_t> overrun_counter_{0};
+
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+};
+} // namespace details
+} // namespace spdlog
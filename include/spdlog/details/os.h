@@ -17,6 +17,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
 
@@ -37,6 +38,7 @@
 
 #else // unix
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -200,6 +202,67 @@ inline bool file_exists(const filename_t &filename) SPDLOG_NOEXCEPT
 #endif
 }
 
+// Return the last modification time of the file (0 if it can't be read)
+inline std::time_t file_mtime(const filename_t &filename) SPDLOG_NOEXCEPT
+{
+#if defined(_WIN32) && defined(SPDLOG_WCHAR_FILENAMES)
+    struct _stat buffer;
+    return _wstat(filename.c_str(), &buffer) == 0 ? buffer.st_mtime : 0;
+#elif defined(_WIN32)
+    struct _stat buffer;
+    return _stat(filename.c_str(), &buffer) == 0 ? buffer.st_mtime : 0;
+#else
+    struct stat buffer;
+    return stat(filename.c_str(), &buffer) == 0 ? buffer.st_mtime : 0;
+#endif
+}
+
+// Return the names of the entries of the given directory (empty if it can't be read)
+inline std::vector<filename_t> dir_files(const filename_t &dir)
+{
+    std::vector<filename_t> names;
+#ifdef _WIN32
+#ifdef SPDLOG_WCHAR_FILENAMES
+    WIN32_FIND_DATAW data;
+    HANDLE handle = ::FindFirstFileW((dir + L"\\*").c_str(), &data);
+#else
+    WIN32_FIND_DATAA data;
+    HANDLE handle = ::FindFirstFileA((dir + "\\*").c_str(), &data);
+#endif
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return names;
+    }
+    do
+    {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            names.emplace_back(data.cFileName);
+        }
+#ifdef SPDLOG_WCHAR_FILENAMES
+    } while (::FindNextFileW(handle, &data));
+#else
+    } while (::FindNextFileA(handle, &data));
+#endif
+    ::FindClose(handle);
+#else
+    DIR *d = ::opendir(dir.c_str());
+    if (d == nullptr)
+    {
+        return names;
+    }
+    while (auto *entry = ::readdir(d))
+    {
+        if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0)
+        {
+            names.emplace_back(entry->d_name);
+        }
+    }
+    ::closedir(d);
+#endif
+    return names;
+}
+
 // Return file size according to open FILE* object
 inline size_t filesize(FILE *f)
 {
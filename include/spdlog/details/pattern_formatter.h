@@ -8,6 +8,7 @@
 #include "spdlog/details/fmt_helper.h"
 #include "spdlog/details/log_msg.h"
 #include "spdlog/details/os.h"
+#include "spdlog/details/time_converter.h"
 #include "spdlog/fmt/fmt.h"
 #include "spdlog/formatter.h"
 
@@ -24,37 +25,35 @@
 namespace spdlog {
 namespace details {
 
-class flag_formatter
-{
-public:
-    virtual ~flag_formatter() = default;
-    virtual void format(const details::log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest) = 0;
-};
+// flag formatters - append the field of one pattern flag to the formatted record:
+//   void format(const details::log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest);
+// they are not virtual: pattern_formatter calls them from the switch of its opcode loop, and
+// static_pattern_formatter (see static_pattern_formatter.h) straight from the parsed pattern.
 
 ///////////////////////////////////////////////////////////////////////
 // name & level pattern appender
 ///////////////////////////////////////////////////////////////////////
-class name_formatter : public flag_formatter
+struct name_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(string_view_t(*msg.logger_name), dest);
     }
 };
 
 // log level appender
-class level_formatter : public flag_formatter
+struct level_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(level::to_c_str(msg.level), dest);
     }
 };
 
 // short log level appender
-class short_level_formatter : public flag_formatter
+struct short_level_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(level::to_short_c_str(msg.level), dest);
     }
@@ -76,9 +75,9 @@ static int to12h(const tm &t)
 
 // Abbreviated weekday name
 static const char *days[]{"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
-class a_formatter : public flag_formatter
+struct a_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(days[tm_time.tm_wday], dest);
     }
@@ -86,9 +85,9 @@ class a_formatter : public flag_formatter
 
 // Full weekday name
 static const char *full_days[]{"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
-class A_formatter : public flag_formatter
+struct A_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(full_days[tm_time.tm_wday], dest);
     }
@@ -96,9 +95,9 @@ class A_formatter : public flag_formatter
 
 // Abbreviated month
 static const char *months[]{"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sept", "Oct", "Nov", "Dec"};
-class b_formatter : public flag_formatter
+struct b_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(months[tm_time.tm_mon], dest);
     }
@@ -107,18 +106,18 @@ class b_formatter : public flag_formatter
 // Full month name
 static const char *full_months[]{
     "January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"};
-class B_formatter : public flag_formatter
+struct B_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(full_months[tm_time.tm_mon], dest);
     }
 };
 
 // Date and time representation (Thu Aug 23 15:35:46 2014)
-class c_formatter final : public flag_formatter
+struct c_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         // fmt::format_to(dest, "{} {} {} ", days[tm_time.tm_wday],
         // months[tm_time.tm_mon], tm_time.tm_mday);
@@ -142,18 +141,18 @@ class c_formatter final : public flag_formatter
 };
 
 // year - 2 digit
-class C_formatter final : public flag_formatter
+struct C_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_year % 100, dest);
     }
 };
 
 // Short MM/DD/YY date, equivalent to %m/%d/%y 08/23/01
-class D_formatter final : public flag_formatter
+struct D_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_mon + 1, dest);
         dest.push_back('/');
@@ -164,72 +163,72 @@ class D_formatter final : public flag_formatter
 };
 
 // year - 4 digit
-class Y_formatter final : public flag_formatter
+struct Y_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::append_int(tm_time.tm_year + 1900, dest);
     }
 };
 
 // month 1-12
-class m_formatter final : public flag_formatter
+struct m_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_mon + 1, dest);
     }
 };
 
 // day of month 1-31
-class d_formatter final : public flag_formatter
+struct d_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_mday, dest);
     }
 };
 
 // hours in 24 format 0-23
-class H_formatter final : public flag_formatter
+struct H_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_hour, dest);
     }
 };
 
 // hours in 12 format 1-12
-class I_formatter final : public flag_formatter
+struct I_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(to12h(tm_time), dest);
     }
 };
 
 // minutes 0-59
-class M_formatter final : public flag_formatter
+struct M_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_min, dest);
     }
 };
 
 // seconds 0-59
-class S_formatter final : public flag_formatter
+struct S_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_sec, dest);
     }
 };
 
 // milliseconds
-class e_formatter final : public flag_formatter
+struct e_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         auto millis = fmt_helper::time_fraction<std::chrono::milliseconds>(msg.time);
         fmt_helper::pad3(static_cast<int>(millis.count()), dest);
@@ -237,9 +236,9 @@ class e_formatter final : public flag_formatter
 };
 
 // microseconds
-class f_formatter final : public flag_formatter
+struct f_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         auto micros = fmt_helper::time_fraction<std::chrono::microseconds>(msg.time);
         fmt_helper::pad6(static_cast<size_t>(micros.count()), dest);
@@ -247,19 +246,19 @@ class f_formatter final : public flag_formatter
 };
 
 // nanoseconds
-class F_formatter final : public flag_formatter
+struct F_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         auto ns = fmt_helper::time_fraction<std::chrono::nanoseconds>(msg.time);
-        fmt::format_to(dest, "{:09}", ns.count());
+        fmt_helper::pad9(static_cast<size_t>(ns.count()), dest);
     }
 };
 
 // seconds since epoch
-class E_formatter final : public flag_formatter
+struct E_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         auto duration = msg.time.time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
@@ -268,33 +267,29 @@ class E_formatter final : public flag_formatter
 };
 
 // AM/PM
-class p_formatter final : public flag_formatter
+struct p_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(ampm(tm_time), dest);
     }
 };
 
 // 12 hour clock 02:55:02 pm
-class r_formatter final : public flag_formatter
+struct r_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
-        fmt_helper::pad2(to12h(tm_time), dest);
-        dest.push_back(':');
-        fmt_helper::pad2(tm_time.tm_min, dest);
-        dest.push_back(':');
-        fmt_helper::pad2(tm_time.tm_sec, dest);
+        fmt_helper::append_hms(to12h(tm_time), tm_time.tm_min, tm_time.tm_sec, dest);
         dest.push_back(' ');
         fmt_helper::append_string_view(ampm(tm_time), dest);
     }
 };
 
 // 24-hour HH:MM time, equivalent to %H:%M
-class R_formatter final : public flag_formatter
+struct R_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         fmt_helper::pad2(tm_time.tm_hour, dest);
         dest.push_back(':');
@@ -303,34 +298,23 @@ class R_formatter final : public flag_formatter
 };
 
 // ISO 8601 time format (HH:MM:SS), equivalent to %H:%M:%S
-class T_formatter final : public flag_formatter
+struct T_formatter
 {
-    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
-        // fmt::format_to(dest, "{:02}:{:02}:{:02}", tm_time.tm_hour,
-        // tm_time.tm_min, tm_time.tm_sec);
-        fmt_helper::pad2(tm_time.tm_hour, dest);
-        dest.push_back(':');
-        fmt_helper::pad2(tm_time.tm_min, dest);
-        dest.push_back(':');
-        fmt_helper::pad2(tm_time.tm_sec, dest);
+        fmt_helper::append_hms(tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, dest);
     }
 };
 
 // ISO 8601 offset from UTC in timezone (+-HH:MM)
-class z_formatter final : public flag_formatter
+struct z_formatter
 {
-public:
-    const std::chrono::seconds cache_refresh = std::chrono::seconds(5);
-
-    z_formatter() = default;
-    z_formatter(const z_formatter &) = delete;
-    z_formatter &operator=(const z_formatter &) = delete;
-
-    void format(const details::log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
 #ifdef _WIN32
-        int total_minutes = get_cached_offset(msg, tm_time);
+        // the offset of the local time at msg.time (cached by the time converter)
+        (void)(tm_time);
+        auto total_minutes = static_cast<int>(time_converter::instance().utc_offset(log_clock::to_time_t(msg.time)) / 60);
 #else
         // No need to chache under gcc,
         // it is very fast (already stored in tm.tm_gmtoff)
@@ -352,105 +336,54 @@ public:
         dest.push_back(':');
         fmt_helper::pad2(total_minutes % 60, dest); // minutes
     }
-
-private:
-    log_clock::time_point last_update_{std::chrono::seconds(0)};
-#ifdef _WIN32
-    int offset_minutes_{0};
-
-    int get_cached_offset(const log_msg &msg, const std::tm &tm_time)
-    {
-        if (msg.time - last_update_ >= cache_refresh)
-        {
-            offset_minutes_ = os::utc_minutes_offset(tm_time);
-            last_update_ = msg.time;
-        }
-        return offset_minutes_;
-    }
-#endif
 };
 
 // Thread id
-class t_formatter final : public flag_formatter
+struct t_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::pad6(msg.thread_id, dest);
     }
 };
 
 // Current pid
-class pid_formatter final : public flag_formatter
+struct pid_formatter
 {
-    void format(const details::log_msg &, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::append_int(details::os::pid(), dest);
     }
 };
 
 // message counter formatter
-class i_formatter final : public flag_formatter
+struct i_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::pad6(msg.msg_id, dest);
     }
 };
 
-class v_formatter final : public flag_formatter
+struct v_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         fmt_helper::append_string_view(msg.payload, dest);
     }
 };
 
-class ch_formatter final : public flag_formatter
-{
-public:
-    explicit ch_formatter(char ch)
-        : ch_(ch)
-    {
-    }
-    void format(const details::log_msg &, const std::tm &, fmt::memory_buffer &dest) override
-    {
-        dest.push_back(ch_);
-    }
-
-private:
-    char ch_;
-};
-
-// aggregate user chars to display as is
-class aggregate_formatter final : public flag_formatter
-{
-public:
-    aggregate_formatter() = default;
-
-    void add_ch(char ch)
-    {
-        str_ += ch;
-    }
-    void format(const details::log_msg &, const std::tm &, fmt::memory_buffer &dest) override
-    {
-        fmt_helper::append_string_view(str_, dest);
-    }
-
-private:
-    std::string str_;
-};
-
 // mark the color range. expect it to be in the form of "%^colored text%$"
-class color_start_formatter final : public flag_formatter
+struct color_start_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         msg.color_range_start = dest.size();
     }
 };
-class color_stop_formatter final : public flag_formatter
+struct color_stop_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    void format(const details::log_msg &msg, const std::tm &, fmt::memory_buffer &dest)
     {
         msg.color_range_end = dest.size();
     }
@@ -458,9 +391,10 @@ class color_stop_formatter final : public flag_formatter
 
 // Full info formatter
 // pattern: [%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v
-class full_formatter final : public flag_formatter
+class full_formatter
 {
-    void format(const details::log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest) override
+public:
+    void format(const details::log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest)
     {
         using std::chrono::duration_cast;
         using std::chrono::milliseconds;
@@ -545,7 +479,7 @@ public:
         : pattern_(std::move(pattern))
         , eol_(std::move(eol))
         , pattern_time_type_(time_type)
-        , last_log_secs_(0)
+        , last_log_secs_(std::chrono::seconds::min()) // no second cached yet
     {
         std::memset(&cached_tm_, 0, sizeof(cached_tm_));
         compile_pattern_(pattern_);
@@ -567,215 +501,347 @@ public:
         {
             cached_tm_ = get_time_(msg);
             last_log_secs_ = secs;
+            format_time_runs_(msg);
         }
 #endif
-        for (auto &f : formatters_)
+        for (const auto &op : ops_)
         {
-            f->format(msg, cached_tm_, dest);
+            format_op_(op, msg, dest);
         }
         // write eol
-        // details::fmt_helper::append_string_view(eol_.c_str(), dest);
-        details::fmt_helper::append_string_view(eol_.c_str(), dest);
+        details::fmt_helper::append_string_view(eol_, dest);
     }
 
 private:
+    // one step of the compiled pattern: a flag, a run of user chars in literals_, or a time run
+    // (text in time_runs_text_)
+    struct pattern_op
+    {
+        char flag;
+        size_t offset;
+        size_t size;
+    };
+
+    static const char literal_op = '\0';
+    static const char time_run_op = '\1';
+
+    // a run of ops that only change every second (date/time flags and user chars).
+    // its text is rendered once per second into time_runs_text_
+    struct time_run
+    {
+        size_t op;    // index in ops_
+        size_t first; // ops of the run in time_run_ops_
+        size_t last;
+    };
+
     std::string pattern_;
     std::string eol_;
     pattern_time_type pattern_time_type_;
     std::tm cached_tm_;
     std::chrono::seconds last_log_secs_;
 
-    std::vector<std::unique_ptr<details::flag_formatter>> formatters_;
+    std::vector<pattern_op> ops_;
+    std::string literals_;
+    std::vector<time_run> time_runs_;
+    std::vector<pattern_op> time_run_ops_;
+    fmt::memory_buffer time_runs_text_;
+    details::full_formatter full_formatter_;
 
     std::tm get_time_(const details::log_msg &msg)
     {
         if (pattern_time_type_ == pattern_time_type::local)
         {
-            return details::os::localtime(log_clock::to_time_t(msg.time));
+            return details::time_converter::instance().localtime(log_clock::to_time_t(msg.time));
         }
-        return details::os::gmtime(log_clock::to_time_t(msg.time));
+        return details::time_converter::gmtime(log_clock::to_time_t(msg.time));
     }
 
-    void handle_flag_(char flag)
+    void format_op_(const pattern_op &op, const details::log_msg &msg, fmt::memory_buffer &dest)
     {
-        switch (flag)
+        switch (op.flag)
         {
-        // logger name
+        case literal_op:
+            details::fmt_helper::append_string_view(string_view_t(literals_.data() + op.offset, op.size), dest);
+            break;
+        case time_run_op:
+            details::fmt_helper::append_string_view(string_view_t(time_runs_text_.data() + op.offset, op.size), dest);
+            break;
         case 'n':
-            formatters_.push_back(details::make_unique<details::name_formatter>());
+            details::name_formatter().format(msg, cached_tm_, dest);
             break;
-
         case 'l':
-            formatters_.push_back(details::make_unique<details::level_formatter>());
+            details::level_formatter().format(msg, cached_tm_, dest);
             break;
-
         case 'L':
-            formatters_.push_back(details::make_unique<details::short_level_formatter>());
+            details::short_level_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('t'):
-            formatters_.push_back(details::make_unique<details::t_formatter>());
+        case 't':
+            details::t_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('v'):
-            formatters_.push_back(details::make_unique<details::v_formatter>());
+        case 'v':
+            details::v_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('a'):
-            formatters_.push_back(details::make_unique<details::a_formatter>());
+        case 'a':
+            details::a_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('A'):
-            formatters_.push_back(details::make_unique<details::A_formatter>());
+        case 'A':
+            details::A_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('b'):
-        case ('h'):
-            formatters_.push_back(details::make_unique<details::b_formatter>());
+        case 'b':
+            details::b_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('B'):
-            formatters_.push_back(details::make_unique<details::B_formatter>());
+        case 'B':
+            details::B_formatter().format(msg, cached_tm_, dest);
             break;
-        case ('c'):
-            formatters_.push_back(details::make_unique<details::c_formatter>());
+        case 'c':
+            details::c_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('C'):
-            formatters_.push_back(details::make_unique<details::C_formatter>());
+        case 'C':
+            details::C_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('Y'):
-            formatters_.push_back(details::make_unique<details::Y_formatter>());
+        case 'Y':
+            details::Y_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('D'):
-        case ('x'):
-            formatters_.push_back(details::make_unique<details::D_formatter>());
+        case 'D':
+            details::D_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('m'):
-            formatters_.push_back(details::make_unique<details::m_formatter>());
+        case 'm':
+            details::m_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('d'):
-            formatters_.push_back(details::make_unique<details::d_formatter>());
+        case 'd':
+            details::d_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('H'):
-            formatters_.push_back(details::make_unique<details::H_formatter>());
+        case 'H':
+            details::H_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('I'):
-            formatters_.push_back(details::make_unique<details::I_formatter>());
+        case 'I':
+            details::I_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('M'):
-            formatters_.push_back(details::make_unique<details::M_formatter>());
+        case 'M':
+            details::M_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('S'):
-            formatters_.push_back(details::make_unique<details::S_formatter>());
+        case 'S':
+            details::S_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('e'):
-            formatters_.push_back(details::make_unique<details::e_formatter>());
+        case 'e':
+            details::e_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('f'):
-            formatters_.push_back(details::make_unique<details::f_formatter>());
+        case 'f':
+            details::f_formatter().format(msg, cached_tm_, dest);
             break;
-        case ('F'):
-            formatters_.push_back(details::make_unique<details::F_formatter>());
+        case 'F':
+            details::F_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('E'):
-            formatters_.push_back(details::make_unique<details::E_formatter>());
+        case 'E':
+            details::E_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('p'):
-            formatters_.push_back(details::make_unique<details::p_formatter>());
+        case 'p':
+            details::p_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('r'):
-            formatters_.push_back(details::make_unique<details::r_formatter>());
+        case 'r':
+            details::r_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('R'):
-            formatters_.push_back(details::make_unique<details::R_formatter>());
+        case 'R':
+            details::R_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('T'):
-        case ('X'):
-            formatters_.push_back(details::make_unique<details::T_formatter>());
+        case 'T':
+            details::T_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('z'):
-            formatters_.push_back(details::make_unique<details::z_formatter>());
+        case 'z':
+            details::z_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('+'):
-            formatters_.push_back(details::make_unique<details::full_formatter>());
+        case '+':
+            full_formatter_.format(msg, cached_tm_, dest);
             break;
-
-        case ('P'):
-            formatters_.push_back(details::make_unique<details::pid_formatter>());
+        case 'P':
+            details::pid_formatter().format(msg, cached_tm_, dest);
             break;
-#ifdef SPDLOG_ENABLE_MESSAGE_COUNTER
-        case ('i'):
-            formatters_.push_back(details::make_unique<details::i_formatter>());
+        case 'i':
+            details::i_formatter().format(msg, cached_tm_, dest);
             break;
-#endif
-        case ('^'):
-            formatters_.push_back(details::make_unique<details::color_start_formatter>());
+        case '^':
+            details::color_start_formatter().format(msg, cached_tm_, dest);
             break;
-
-        case ('$'):
-            formatters_.push_back(details::make_unique<details::color_stop_formatter>());
+        case '$':
+            details::color_stop_formatter().format(msg, cached_tm_, dest);
             break;
-
-        default: // Unknown flag appears as is
-            formatters_.push_back(details::make_unique<details::ch_formatter>('%'));
-            formatters_.push_back(details::make_unique<details::ch_formatter>(flag));
+        default:
             break;
         }
     }
 
+    // render the time runs for the second of msg (cached_tm_ is up to date)
+    void format_time_runs_(const details::log_msg &msg)
+    {
+        time_runs_text_.clear();
+        for (auto &run : time_runs_)
+        {
+            auto start = time_runs_text_.size();
+            for (size_t i = run.first; i < run.last; i++)
+            {
+                format_op_(time_run_ops_[i], msg, time_runs_text_);
+            }
+            ops_[run.op].offset = start;
+            ops_[run.op].size = time_runs_text_.size() - start;
+        }
+    }
+
+    // the opcode of the given flag (aliases mapped to the same opcode), or literal_op if unknown
+    static char flag_op_(char flag)
+    {
+        switch (flag)
+        {
+        case 'h':
+            return 'b';
+        case 'x':
+            return 'D';
+        case 'X':
+            return 'T';
+        case 'n':
+        case 'l':
+        case 'L':
+        case 't':
+        case 'v':
+        case 'a':
+        case 'A':
+        case 'b':
+        case 'B':
+        case 'c':
+        case 'C':
+        case 'Y':
+        case 'D':
+        case 'm':
+        case 'd':
+        case 'H':
+        case 'I':
+        case 'M':
+        case 'S':
+        case 'e':
+        case 'f':
+        case 'F':
+        case 'E':
+        case 'p':
+        case 'r':
+        case 'R':
+        case 'T':
+        case 'z':
+        case '+':
+        case 'P':
+#ifdef SPDLOG_ENABLE_MESSAGE_COUNTER
+        case 'i':
+#endif
+        case '^':
+        case '$':
+            return flag;
+        default:
+            return literal_op;
+        }
+    }
+
+    void add_literal_(const char *chars, size_t n)
+    {
+        if (!ops_.empty() && ops_.back().flag == literal_op)
+        {
+            ops_.back().size += n;
+        }
+        else
+        {
+            ops_.push_back(pattern_op{literal_op, literals_.size(), n});
+        }
+        literals_.append(chars, n);
+    }
+
     void compile_pattern_(const std::string &pattern)
     {
+        ops_.clear();
+        literals_.clear();
         auto end = pattern.end();
-        std::unique_ptr<details::aggregate_formatter> user_chars;
-        formatters_.clear();
         for (auto it = pattern.begin(); it != end; ++it)
         {
             if (*it == '%')
             {
-                if (user_chars) // append user chars found so far
+                if (++it == end)
                 {
-                    formatters_.push_back(std::move(user_chars));
+                    break;
                 }
-                if (++it != end)
+                char op = flag_op_(*it);
+                if (op != literal_op)
                 {
-                    handle_flag_(*it);
+                    ops_.push_back(pattern_op{op, 0, 0});
                 }
-                else
+                else // Unknown flag appears as is
                 {
-                    break;
+                    add_literal_(&*(it - 1), 2);
                 }
             }
             else // chars not following the % sign should be displayed as is
             {
-                if (!user_chars)
-                {
-                    user_chars = details::make_unique<details::aggregate_formatter>();
-                }
-                user_chars->add_ch(*it);
+                add_literal_(&*it, 1);
             }
         }
-        if (user_chars) // append raw chars found so far
+#ifndef SPDLOG_NO_DATETIME
+        compile_time_runs_();
+#endif
+    }
+
+    // flags whose text only changes every second
+    static bool is_time_flag_(char flag)
+    {
+        switch (flag)
+        {
+        case 'a':
+        case 'A':
+        case 'b':
+        case 'B':
+        case 'c':
+        case 'C':
+        case 'Y':
+        case 'D':
+        case 'm':
+        case 'd':
+        case 'H':
+        case 'I':
+        case 'M':
+        case 'S':
+        case 'E':
+        case 'p':
+        case 'r':
+        case 'R':
+        case 'T':
+        case 'z':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // replace each sequence of date/time flags (and the user chars around them) by one
+    // time run op, so their text is rendered once per second instead of on every record
+    void compile_time_runs_()
+    {
+        time_runs_.clear();
+        time_run_ops_.clear();
+        std::vector<pattern_op> ops;
+        for (size_t i = 0; i < ops_.size();)
         {
-            formatters_.push_back(std::move(user_chars));
+            size_t end = i;
+            bool has_time_flag = false;
+            while (end < ops_.size() && (ops_[end].flag == literal_op || is_time_flag_(ops_[end].flag)))
+            {
+                has_time_flag |= ops_[end].flag != literal_op;
+                ++end;
+            }
+            if (!has_time_flag)
+            {
+                ops.push_back(ops_[i++]);
+                continue;
+            }
+            time_runs_.push_back(time_run{ops.size(), time_run_ops_.size(), time_run_ops_.size() + end - i});
+            time_run_ops_.insert(time_run_ops_.end(), ops_.begin() + static_cast<std::ptrdiff_t>(i), ops_.begin() + static_cast<std::ptrdiff_t>(end));
+            ops.push_back(pattern_op{time_run_op, 0, 0});
+            i = end;
         }
+        ops_.swap(ops);
     }
 };
 } // namespace spdlog
@@ -0,0 +1,177 @@
+#pragma once
+
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// storage for async message payloads.
+//
+// payload_slab - fixed number of fixed size blocks, owned by the thread pool.
+// the free blocks are kept in a lock-free queue, so allocating and releasing a block
+// never calls malloc nor takes a lock.
+//
+// async_payload - payload of a single async message. small payloads are stored inline,
+// larger ones in a slab block. payloads larger than a block (or when the slab is
+// exhausted) fall back to the heap.
+
+#include "spdlog/common.h"
+#include "spdlog/details/mpmc_lockfree_q.h"
+
+#include <cstring>
+#include <memory>
+
+namespace spdlog {
+namespace details {
+
+class payload_slab
+{
+public:
+    payload_slab(size_t block_size, size_t blocks_n)
+        : block_size_(block_size)
+        , blocks_n_(blocks_n)
+        , storage_(new char[block_size * blocks_n])
+        , free_blocks_(blocks_n)
+    {
+        for (size_t i = 0; i < blocks_n_; i++)
+        {
+            size_t index = i;
+            free_blocks_.try_enqueue(std::move(index));
+        }
+    }
+
+    payload_slab(const payload_slab &) = delete;
+    payload_slab &operator=(const payload_slab &) = delete;
+
+    // return a free block, or nullptr if size is larger than a block or no block is free
+    char *allocate(size_t size)
+    {
+        size_t index;
+        if (size > block_size_ || !free_blocks_.try_dequeue(index))
+        {
+            return nullptr;
+        }
+        return storage_.get() + index * block_size_;
+    }
+
+    void deallocate(char *block)
+    {
+        size_t index = static_cast<size_t>(block - storage_.get()) / block_size_;
+        free_blocks_.try_enqueue(std::move(index));
+    }
+
+    size_t block_size() const
+    {
+        return block_size_;
+    }
+
+private:
+    size_t block_size_;
+    size_t blocks_n_;
+    std::unique_ptr<char[]> storage_;
+    mpmc_lockfree_queue<size_t> free_blocks_;
+};
+
+class async_payload
+{
+public:
+    static const size_t inline_size = 176;
+
+    async_payload() = default;
+
+    async_payload(const async_payload &) = delete;
+    async_payload &operator=(const async_payload &) = delete;
+
+    async_payload(async_payload &&other) SPDLOG_NOEXCEPT
+    {
+        move_from_(other);
+    }
+
+    async_payload &operator=(async_payload &&other) SPDLOG_NOEXCEPT
+    {
+        if (this != &other)
+        {
+            release_();
+            move_from_(other);
+        }
+        return *this;
+    }
+
+    ~async_payload()
+    {
+        release_();
+    }
+
+    // copy the given bytes, using the slab (if any) for payloads that don't fit inline
+    void assign(const char *bytes, size_t size, payload_slab *slab)
+    {
+        release_();
+        char *dest = inline_buf_;
+        if (size > inline_size)
+        {
+            external_ = slab != nullptr ? slab->allocate(size) : nullptr;
+            if (external_ != nullptr)
+            {
+                slab_ = slab;
+            }
+            else
+            {
+                external_ = new char[size];
+            }
+            dest = external_;
+        }
+        if (size != 0)
+        {
+            std::memcpy(dest, bytes, size);
+        }
+        size_ = size;
+    }
+
+    const char *data() const
+    {
+        return external_ != nullptr ? external_ : inline_buf_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    void move_from_(async_payload &other)
+    {
+        external_ = other.external_;
+        slab_ = other.slab_;
+        size_ = other.size_;
+        if (external_ == nullptr && size_ != 0)
+        {
+            std::memcpy(inline_buf_, other.inline_buf_, size_);
+        }
+        other.external_ = nullptr;
+        other.slab_ = nullptr;
+        other.size_ = 0;
+    }
+
+    void release_()
+    {
+        if (slab_ != nullptr)
+        {
+            slab_->deallocate(external_);
+        }
+        else
+        {
+            delete[] external_;
+        }
+        external_ = nullptr;
+        slab_ = nullptr;
+        size_ = 0;
+    }
+
+    char inline_buf_[inline_size];
+    char *external_ = nullptr;
+    payload_slab *slab_ = nullptr; // set if external_ is a slab block
+    size_t size_ = 0;
+};
+
+} // namespace details
+} // namespace spdlog
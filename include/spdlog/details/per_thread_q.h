@@ -0,0 +1,513 @@
+#pragma once
+
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// per producer thread queues with a merging consumer.
+// enable it for the async thread pool by defining SPDLOG_PER_THREAD_QUEUE in tweakme.h.
+//
+// each producer thread lazily gets its own single producer/single consumer ring, so the
+// hot path only writes to cache lines owned by the calling thread.
+// the consumer merges the heads of all rings using the "Before" ordering
+// (log time and message id for async_msg), so the order of each producer thread is kept.
+// it takes the items published when it scans the rings, kept in a heap by their head item, so
+// a pop costs O(log rings), and scans the rings again once they are taken.
+//
+// enqueue(..) - will spin (and yield) until room found in the calling thread's ring.
+// enqueue_nowait(..) - will drop the new message if the calling thread's ring is full
+// (the oldest message is owned by the consumer and cannot be overrun by the producer).
+// try_enqueue(..) - will return false (leaving the item untouched) if the calling thread's ring
+// is full.
+// dequeue_for(..) - will block until one of the rings is not empty or timeout have passed.
+// dequeue_bulk_for(..) - same as dequeue_for(..), but moves out up to max_items messages.
+//
+// memory policy: each ring holds at most max_items_per_thread items. it starts with room for
+// min_ring_capacity items and grows when full: the producer moves on to a spare buffer twice as
+// large (up to max_items_per_thread), and the consumer frees the previous one once drained.
+// the consumer allocates the spare buffers ahead of time (when it pops from the ring), so the
+// producers allocate nothing after their first message. a producer that fills its buffer
+// before the consumer provided the next one finds the ring full, as with a full ring.
+// rings of exited threads are reclaimed as soon as they are drained.
+// a ring that stayed empty for idle_timeout is shrunk back to its initial size by the consumer.
+// the thread local entries of the destroyed queues are pruned when the thread gets a new ring.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace spdlog {
+namespace details {
+
+template<typename T, typename Before>
+class per_thread_queue
+{
+public:
+    using item_type = T;
+
+    explicit per_thread_queue(size_t max_items_per_thread, std::chrono::milliseconds idle_timeout = std::chrono::seconds(60))
+        : capacity_(round_up_pow2_(max_items_per_thread))
+        , initial_capacity_(capacity_ < min_ring_capacity ? capacity_ : min_ring_capacity)
+        , idle_timeout_(idle_timeout)
+        , id_(next_queue_id_())
+    {
+    }
+
+    per_thread_queue(const per_thread_queue &) = delete;
+    per_thread_queue &operator=(const per_thread_queue &) = delete;
+
+    ~per_thread_queue()
+    {
+        // rings may outlive the queue in the producers' thread local storage.
+        // release their items now, no producer will push to them again, and let the producers
+        // prune them.
+        for (auto &r : rings_)
+        {
+            r->release_segments();
+            r->orphaned.store(true, std::memory_order_release);
+        }
+        for (auto &r : pending_rings_)
+        {
+            r->release_segments();
+            r->orphaned.store(true, std::memory_order_release);
+        }
+    }
+
+    // try to enqueue and spin if no room left in the calling thread's ring
+    void enqueue(T &&item)
+    {
+        ring &r = local_ring_();
+        for (unsigned spins = 0; !try_push_(r, item); ++spins)
+        {
+            if (spins > 16)
+            {
+                std::this_thread::yield();
+            }
+        }
+        wake_consumer_();
+    }
+
+    // enqueue immediately. drop the message if no room left in the calling thread's ring.
+    void enqueue_nowait(T &&item)
+    {
+        if (try_push_(local_ring_(), item))
+        {
+            wake_consumer_();
+        }
+        else
+        {
+            overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // enqueue immediately. return false if no room left in the calling thread's ring.
+    bool try_enqueue(T &&item)
+    {
+        if (!try_push_(local_ring_(), item))
+        {
+            return false;
+        }
+        wake_consumer_();
+        return true;
+    }
+
+    // try to dequeue the next item (in "Before" order). if no item found. wait upto timeout and try
+    // again
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        std::unique_lock<std::mutex> lock(consumer_mutex_);
+        if (pop_next_(popped_item))
+        {
+            return true;
+        }
+        collect_rings_();
+
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool dequeued = consumer_cv_.wait_for(lock, wait_duration, [&] { return this->pop_next_(popped_item); });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return dequeued;
+    }
+
+    // try to dequeue up to max_items (in "Before" order). if no item found. wait upto timeout and
+    // try again
+    // Return the number of dequeued items (0 on timeout)
+    size_t dequeue_bulk_for(T *popped_items, size_t max_items, std::chrono::milliseconds wait_duration)
+    {
+        if (max_items == 0 || !dequeue_for(popped_items[0], wait_duration))
+        {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(consumer_mutex_);
+        size_t count = 1;
+        while (count < max_items && pop_next_(popped_items[count]))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    size_t overrun_counter()
+    {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    static const size_t cacheline_size = 64;
+    static const size_t min_ring_capacity = 64;
+
+    enum ring_state
+    {
+        ring_live,     // producer not pushing
+        ring_pushing,  // producer is pushing
+        ring_shrinking // consumer is replacing the buffers of the idle ring
+    };
+
+    // buffer of a ring, for the positions from begin. when it is full the producer continues in
+    // the spare segment from position end.
+    struct segment
+    {
+        explicit segment(size_t capacity, size_t first = 0)
+            : slots(new T[capacity])
+            , mask(capacity - 1)
+            , begin(first)
+        {
+        }
+
+        std::unique_ptr<T[]> slots;
+        const size_t mask;
+        size_t begin;                                     // set by the producer that moves to it
+        std::atomic<size_t> end{static_cast<size_t>(-1)}; // set (before next is used) on growth
+        std::unique_ptr<segment> next;
+    };
+
+    struct ring
+    {
+        ring(size_t capacity, size_t spare_capacity)
+            : tail_capacity(capacity)
+            , head_segment(new segment(capacity))
+        {
+            tail_segment = head_segment.get();
+            if (spare_capacity > capacity)
+            {
+                spare.store(new segment(spare_capacity), std::memory_order_relaxed);
+            }
+        }
+
+        ~ring()
+        {
+            release_segments();
+        }
+
+        void release_segments()
+        {
+            head_segment.reset();
+            delete spare.exchange(nullptr, std::memory_order_acquire);
+        }
+
+        // producer side
+        char pad0_[cacheline_size];
+        segment *tail_segment;
+        std::atomic<size_t> tail{0};
+        std::atomic<int> state{ring_live};
+        std::atomic<size_t> tail_capacity; // capacity of tail_segment, read by the consumer
+        size_t cached_head = 0;
+
+        // allocated by the consumer, taken by the producer
+        char pad1_[cacheline_size];
+        std::atomic<segment *> spare{nullptr};
+
+        // consumer side (owns the segments)
+        char pad2_[cacheline_size];
+        std::unique_ptr<segment> head_segment;
+        std::atomic<size_t> head{0};
+        std::atomic<bool> abandoned{false};
+        std::atomic<bool> orphaned{false}; // the queue was destroyed
+        clock::time_point last_active = clock::now();
+        T *front = nullptr;    // head item, while the ring is in the ready heap
+        size_t ready_tail = 0; // tail when the ring entered the ready heap
+    };
+
+    using ring_ptr = std::shared_ptr<ring>;
+
+    // rings of the calling thread, one per queue instance. marked as abandoned on thread exit.
+    struct thread_rings
+    {
+        std::vector<std::pair<size_t, ring_ptr>> entries;
+
+        ~thread_rings()
+        {
+            for (auto &e : entries)
+            {
+                e.second->abandoned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    static size_t next_queue_id_()
+    {
+        static std::atomic<size_t> s_next_id{1};
+        return s_next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static size_t round_up_pow2_(size_t n)
+    {
+        size_t pow2 = 2;
+        while (pow2 < n)
+        {
+            pow2 <<= 1;
+        }
+        return pow2;
+    }
+
+    ring &local_ring_()
+    {
+        static thread_local thread_rings tl_rings;
+        for (auto &e : tl_rings.entries)
+        {
+            if (e.first == id_)
+            {
+                return *e.second;
+            }
+        }
+
+        // first message from this thread: create and register its ring (and forget the rings of
+        // the queues destroyed meanwhile)
+        auto orphaned = [](const std::pair<size_t, ring_ptr> &e) { return e.second->orphaned.load(std::memory_order_acquire); };
+        tl_rings.entries.erase(std::remove_if(tl_rings.entries.begin(), tl_rings.entries.end(), orphaned), tl_rings.entries.end());
+        auto new_ring = std::make_shared<ring>(initial_capacity_, spare_capacity_(initial_capacity_));
+        tl_rings.entries.emplace_back(id_, new_ring);
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_rings_.push_back(new_ring);
+        }
+        has_pending_.store(true, std::memory_order_release);
+        return *new_ring;
+    }
+
+    // producer: push the item if there is room. the item is moved only on success.
+    bool try_push_(ring &r, T &item)
+    {
+        int expected = ring_live;
+        while (!r.state.compare_exchange_weak(expected, ring_pushing, std::memory_order_acquire))
+        {
+            // the consumer is shrinking the idle ring
+            expected = ring_live;
+            std::this_thread::yield();
+        }
+
+        size_t tail = r.tail.load(std::memory_order_relaxed);
+        segment *seg = r.tail_segment;
+        if (tail - std::max(r.cached_head, seg->begin) > seg->mask)
+        {
+            r.cached_head = r.head.load(std::memory_order_acquire);
+            if (tail - r.cached_head >= capacity_)
+            {
+                r.state.store(ring_live, std::memory_order_release);
+                return false; // full
+            }
+            if (tail - std::max(r.cached_head, seg->begin) > seg->mask)
+            {
+                // the segment is full: continue in the spare one, if the consumer provided it yet
+                segment *spare = r.spare.exchange(nullptr, std::memory_order_acquire);
+                if (spare == nullptr)
+                {
+                    r.state.store(ring_live, std::memory_order_release);
+                    return false;
+                }
+                spare->begin = tail;
+                seg->next.reset(spare);
+                seg->end.store(tail, std::memory_order_release);
+                seg = spare;
+                r.tail_segment = seg;
+                r.tail_capacity.store(seg->mask + 1, std::memory_order_relaxed);
+            }
+        }
+        seg->slots[tail & seg->mask] = std::move(item);
+        r.tail.store(tail + 1, std::memory_order_release);
+        r.state.store(ring_live, std::memory_order_release);
+        return true;
+    }
+
+    // wake a parked consumer (if any) after publishing a new item
+    void wake_consumer_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) != 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(consumer_mutex_);
+            }
+            consumer_cv_.notify_one();
+        }
+    }
+
+    // consumer (consumer_mutex_ held): pop the earliest head of the ready rings
+    bool pop_next_(T &popped_item)
+    {
+        if (ready_.empty() && !fill_ready_())
+        {
+            return false;
+        }
+
+        std::pop_heap(ready_.begin(), ready_.end(), later_);
+        ring *r = ready_.back();
+        popped_item = std::move(*r->front);
+        size_t head = r->head.load(std::memory_order_relaxed) + 1;
+        r->head.store(head, std::memory_order_release);
+        r->last_active = clock::now();
+        provide_spare_(*r);
+        if (head != r->ready_tail)
+        {
+            r->front = front_(*r);
+            std::push_heap(ready_.begin(), ready_.end(), later_);
+        }
+        else
+        {
+            ready_.pop_back();
+        }
+        return true;
+    }
+
+    // consumer: put the rings with items in the ready heap. false if all are empty
+    bool fill_ready_()
+    {
+        if (has_pending_.load(std::memory_order_acquire))
+        {
+            adopt_pending_rings_();
+        }
+        for (auto &r : rings_)
+        {
+            size_t tail = r->tail.load(std::memory_order_acquire);
+            if (tail != r->head.load(std::memory_order_relaxed))
+            {
+                r->ready_tail = tail;
+                r->front = front_(*r);
+                ready_.push_back(r.get());
+            }
+        }
+        std::make_heap(ready_.begin(), ready_.end(), later_);
+        return !ready_.empty();
+    }
+
+    // heap order: the ring with the earliest head item on top
+    static bool later_(const ring *lhs, const ring *rhs)
+    {
+        return Before()(*rhs->front, *lhs->front);
+    }
+
+    // consumer: the item at the head of the ring (not empty). drops the segments drained
+    static T *front_(ring &r)
+    {
+        size_t head = r.head.load(std::memory_order_relaxed);
+        segment *seg = r.head_segment.get();
+        while (head == seg->end.load(std::memory_order_acquire))
+        {
+            r.head_segment = std::move(seg->next);
+            seg = r.head_segment.get();
+        }
+        return &seg->slots[head & seg->mask];
+    }
+
+    size_t spare_capacity_(size_t capacity) const
+    {
+        return 2 * capacity < capacity_ ? 2 * capacity : capacity_;
+    }
+
+    // consumer: allocate the segment the producer continues in once its segment is full
+    void provide_spare_(ring &r)
+    {
+        size_t current = r.tail_capacity.load(std::memory_order_relaxed);
+        if (current < capacity_ && r.spare.load(std::memory_order_relaxed) == nullptr)
+        {
+            r.spare.store(new segment(spare_capacity_(current)), std::memory_order_release);
+        }
+    }
+
+    void adopt_pending_rings_()
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        has_pending_.store(false, std::memory_order_relaxed);
+        for (auto &r : pending_rings_)
+        {
+            rings_.push_back(std::move(r));
+        }
+        pending_rings_.clear();
+    }
+
+    // consumer (consumer_mutex_ held, all rings empty): reclaim the rings of exited threads and
+    // shrink the idle ones.
+    void collect_rings_()
+    {
+        auto now = clock::now();
+        if (now - last_collect_ < std::chrono::seconds(1))
+        {
+            return;
+        }
+        last_collect_ = now;
+
+        auto drained = [](const ring_ptr &r) {
+            return r->abandoned.load(std::memory_order_acquire) &&
+                   r->head.load(std::memory_order_relaxed) == r->tail.load(std::memory_order_acquire);
+        };
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), drained), rings_.end());
+
+        for (auto &r : rings_)
+        {
+            if (now - r->last_active < idle_timeout_)
+            {
+                continue;
+            }
+            if (r->tail_capacity.load(std::memory_order_relaxed) == initial_capacity_)
+            {
+                continue; // never grew: a single segment of the initial size
+            }
+            int expected = ring_live;
+            if (!r->state.compare_exchange_strong(expected, ring_shrinking, std::memory_order_acquire))
+            {
+                continue;
+            }
+            size_t tail = r->tail.load(std::memory_order_relaxed);
+            if (r->head.load(std::memory_order_relaxed) == tail)
+            {
+                r->release_segments();
+                r->head_segment.reset(new segment(initial_capacity_, tail));
+                r->tail_segment = r->head_segment.get();
+                r->tail_capacity.store(initial_capacity_, std::memory_order_relaxed);
+                provide_spare_(*r);
+            }
+            r->state.store(ring_live, std::memory_order_release);
+        }
+    }
+
+    const size_t capacity_;
+    const size_t initial_capacity_;
+    const std::chrono::milliseconds idle_timeout_;
+    const size_t id_;
+
+    // consumer side
+    std::mutex consumer_mutex_;
+    std::condition_variable consumer_cv_;
+    std::vector<ring_ptr> rings_;
+    std::vector<ring *> ready_; // heap of the rings with items (see pop_next_)
+    clock::time_point last_collect_ = clock::now();
+    std::atomic<size_t> sleepers_{0};
+
+    // rings registered by new producer threads, adopted by the consumer
+    std::mutex pending_mutex_;
+    std::vector<ring_ptr> pending_rings_;
+    std::atomic<bool> has_pending_{false};
+
+    std::atomic<size_t> overrun_counter_{0};
+};
+} // namespace details
+} // namespace spdlog
@@ -9,6 +9,12 @@
 // An attempt to create a logger with an already existing name will be ignored
 // If user requests a non existing logger, nullptr will be returned
 // This class is thread safe
+//
+// The changes are serialized by a mutex, and each publishes an immutable snapshot of the
+// loggers (weak pointers - a snapshot never keeps a dropped logger alive).
+// The lookups (get, default_logger, apply_all, flush_all) read the snapshot without locking:
+// each thread keeps the last one it read, and checks it's still current with a single load
+// of the version counter.
 
 #include "spdlog/common.h"
 #include "spdlog/details/periodic_worker.h"
@@ -23,11 +29,13 @@
 #endif
 #endif // SPDLOG_DISABLE_DEFAULT_LOGGER
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace spdlog {
 namespace details {
@@ -45,6 +53,7 @@ public:
         auto logger_name = new_logger->name();
         throw_if_exists_(logger_name);
         loggers_[logger_name] = std::move(new_logger);
+        publish_();
     }
 
     void register_and_init(std::shared_ptr<logger> new_logger)
@@ -66,19 +75,19 @@ public:
 
         // add to registry
         loggers_[logger_name] = std::move(new_logger);
+        publish_();
     }
 
     std::shared_ptr<logger> get(const std::string &logger_name)
     {
-        std::lock_guard<std::mutex> lock(logger_map_mutex_);
-        auto found = loggers_.find(logger_name);
-        return found == loggers_.end() ? nullptr : found->second;
+        const loggers_snapshot &snapshot = current_snapshot_();
+        auto found = snapshot.loggers.find(logger_name);
+        return found == snapshot.loggers.end() ? nullptr : found->second.lock();
     }
 
     std::shared_ptr<logger> default_logger()
     {
-        std::lock_guard<std::mutex> lock(logger_map_mutex_);
-        return default_logger_;
+        return current_snapshot_().default_logger.lock();
     }
 
     // Return raw ptr to the default logger.
@@ -87,7 +96,7 @@ public:
     // e.g do not call set_default_logger() from one thread while calling spdlog::info() from another.
     logger *get_default_raw()
     {
-        return default_logger_.get();
+        return default_logger_raw_.load(std::memory_order_acquire);
     }
 
     // set default logger.
@@ -105,6 +114,8 @@ public:
             loggers_[new_default_logger->name()] = new_default_logger;
         }
         default_logger_ = std::move(new_default_logger);
+        default_logger_raw_.store(default_logger_.get(), std::memory_order_release);
+        publish_();
     }
 
     void set_tp(std::shared_ptr<thread_pool> tp)
@@ -167,21 +178,20 @@ public:
         err_handler_ = handler;
     }
 
+    // the loggers registered when called (the function may register or drop loggers)
     void apply_all(const std::function<void(const std::shared_ptr<logger>)> &fun)
     {
-        std::lock_guard<std::mutex> lock(logger_map_mutex_);
-        for (auto &l : loggers_)
+        for (auto &l : live_loggers_())
         {
-            fun(l.second);
+            fun(l);
         }
     }
 
     void flush_all()
     {
-        std::lock_guard<std::mutex> lock(logger_map_mutex_);
-        for (auto &l : loggers_)
+        for (auto &l : live_loggers_())
         {
-            l.second->flush();
+            l->flush();
         }
     }
 
@@ -192,7 +202,9 @@ public:
         if (default_logger_ && default_logger_->name() == logger_name)
         {
             default_logger_.reset();
+            default_logger_raw_.store(nullptr, std::memory_order_release);
         }
+        publish_();
     }
 
     void drop_all()
@@ -200,6 +212,8 @@ public:
         std::lock_guard<std::mutex> lock(logger_map_mutex_);
         loggers_.clear();
         default_logger_.reset();
+        default_logger_raw_.store(nullptr, std::memory_order_release);
+        publish_();
     }
 
     // clean all resources and threads started by the registry
@@ -244,13 +258,63 @@ private:
 
         const char *default_logger_name = "";
         default_logger_ = std::make_shared<spdlog::logger>(default_logger_name, std::move(color_sink));
+        default_logger_raw_.store(default_logger_.get(), std::memory_order_relaxed);
         loggers_[default_logger_name] = default_logger_;
 
 #endif // SPDLOG_DISABLE_DEFAULT_LOGGER
+        publish_();
     }
 
     ~registry() = default;
 
+    struct loggers_snapshot
+    {
+        std::unordered_map<std::string, std::weak_ptr<logger>> loggers;
+        std::weak_ptr<logger> default_logger;
+        unsigned long long version{0};
+    };
+
+    // publish the current loggers (called with logger_map_mutex_ locked)
+    void publish_()
+    {
+        auto snapshot = std::make_shared<loggers_snapshot>();
+        snapshot->loggers.reserve(loggers_.size());
+        for (auto &l : loggers_)
+        {
+            snapshot->loggers.emplace(l.first, l.second);
+        }
+        snapshot->default_logger = default_logger_;
+        snapshot->version = version_.load(std::memory_order_relaxed) + 1;
+        std::atomic_store(&snapshot_, std::shared_ptr<const loggers_snapshot>(std::move(snapshot)));
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    // the current snapshot, from the cache of this thread if it's still current
+    const loggers_snapshot &current_snapshot_()
+    {
+        static thread_local std::shared_ptr<const loggers_snapshot> cached;
+        if (!cached || cached->version != version_.load(std::memory_order_acquire))
+        {
+            cached = std::atomic_load(&snapshot_);
+        }
+        return *cached;
+    }
+
+    std::vector<std::shared_ptr<logger>> live_loggers_()
+    {
+        auto snapshot = std::atomic_load(&snapshot_);
+        std::vector<std::shared_ptr<logger>> loggers;
+        loggers.reserve(snapshot->loggers.size());
+        for (auto &l : snapshot->loggers)
+        {
+            if (auto live = l.second.lock())
+            {
+                loggers.push_back(std::move(live));
+            }
+        }
+        return loggers;
+    }
+
     void throw_if_exists_(const std::string &logger_name)
     {
         if (loggers_.find(logger_name) != loggers_.end())
@@ -269,6 +333,9 @@ private:
     std::shared_ptr<thread_pool> tp_;
     std::unique_ptr<periodic_worker> periodic_flusher_;
     std::shared_ptr<logger> default_logger_;
+    std::atomic<logger *> default_logger_raw_{nullptr};
+    std::shared_ptr<const loggers_snapshot> snapshot_; // accessed with std::atomic_load/atomic_store
+    std::atomic<unsigned long long> version_{0};
 };
 
 } // namespace details
@@ -0,0 +1,132 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Worker thread of the rotating file sinks - runs the housekeeping of the closed log files
+// (e.g. deleting the old ones) off the logging path.
+//
+// The thread is created by the first post(..) and joined on destruction, after the pending
+// jobs are done.
+// A job reports errors by throwing. The error is kept and thrown (as spdlog_ex) by the next
+// call to check_error().
+
+#include "spdlog/common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace spdlog {
+namespace details {
+
+class rotation_worker
+{
+public:
+    using job = std::function<void()>;
+
+    rotation_worker() = default;
+
+    rotation_worker(const rotation_worker &) = delete;
+    rotation_worker &operator=(const rotation_worker &) = delete;
+
+    // run the pending jobs, then stop the worker thread and join it
+    ~rotation_worker()
+    {
+        if (worker_thread_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                active_ = false;
+            }
+            cv_.notify_one();
+            worker_thread_.join();
+        }
+    }
+
+    void post(job j)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(j));
+            if (!worker_thread_.joinable())
+            {
+                worker_thread_ = std::thread(&rotation_worker::worker_loop_, this);
+            }
+        }
+        cv_.notify_one();
+    }
+
+    // throw the error of a finished job, if any
+    void check_error()
+    {
+        if (!has_error_.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        std::string err;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            err.swap(error_);
+            has_error_ = false;
+        }
+        if (!err.empty())
+        {
+            throw spdlog_ex(err);
+        }
+    }
+
+private:
+
+    void worker_loop_()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            cv_.wait(lock, [this] { return !jobs_.empty() || !active_; });
+            if (jobs_.empty())
+            {
+                return; // active_ == false and nothing left to do
+            }
+            job j = std::move(jobs_.front());
+            jobs_.pop_front();
+            lock.unlock();
+            std::string err;
+            try
+            {
+                j();
+            }
+            catch (const std::exception &ex)
+            {
+                err = ex.what();
+            }
+            catch (...)
+            {
+                err = "Unknown exception in rotation worker";
+            }
+            lock.lock();
+            if (!err.empty())
+            {
+                error_ = std::move(err);
+                has_error_ = true;
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<job> jobs_;
+    bool active_ = true;
+    std::string error_;
+    std::atomic<bool> has_error_{false};
+    std::thread worker_thread_;
+};
+} // namespace details
+} // namespace spdlog
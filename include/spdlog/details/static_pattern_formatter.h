@@ -0,0 +1,239 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Pattern formatter with the pattern parsed at compile time.
+// SPDLOG_STATIC_PATTERN(pattern) names a formatter type whose format() is one straight-line
+// function: the flag formatters and the literal runs of the pattern, inlined in order, without
+// the opcode loop of pattern_formatter.
+// The pattern must be a string literal of at most 127 chars, with the same flags as
+// pattern_formatter.
+//
+// usage:
+//   using my_formatter = SPDLOG_STATIC_PATTERN("[%H:%M:%S.%e] [%l] %v");
+//   sink->set_formatter(spdlog::details::make_unique<my_formatter>());
+
+#include "spdlog/details/pattern_formatter.h"
+
+#include <cstring>
+
+namespace spdlog {
+namespace details {
+
+template<char... Chars>
+struct static_chars
+{
+    void format(const log_msg &, const std::tm &, fmt::memory_buffer &dest)
+    {
+        static const char chars[] = {Chars...};
+        fmt_helper::append_string_view(string_view_t(chars, sizeof...(Chars)), dest);
+    }
+};
+
+template<>
+struct static_chars<>
+{
+    void format(const log_msg &, const std::tm &, fmt::memory_buffer &)
+    {
+    }
+};
+
+// the formatter of each flag. unknown flags appear as is
+template<char Flag>
+struct static_flag
+{
+    using type = static_chars<'%', Flag>;
+};
+
+#define SPDLOG_STATIC_FLAG_(flag, formatter_type)                                                                                          \
+    template<>                                                                                                                             \
+    struct static_flag<flag>                                                                                                               \
+    {                                                                                                                                      \
+        using type = formatter_type;                                                                                                       \
+    };
+
+SPDLOG_STATIC_FLAG_('n', name_formatter)
+SPDLOG_STATIC_FLAG_('l', level_formatter)
+SPDLOG_STATIC_FLAG_('L', short_level_formatter)
+SPDLOG_STATIC_FLAG_('t', t_formatter)
+SPDLOG_STATIC_FLAG_('v', v_formatter)
+SPDLOG_STATIC_FLAG_('a', a_formatter)
+SPDLOG_STATIC_FLAG_('A', A_formatter)
+SPDLOG_STATIC_FLAG_('b', b_formatter)
+SPDLOG_STATIC_FLAG_('h', b_formatter)
+SPDLOG_STATIC_FLAG_('B', B_formatter)
+SPDLOG_STATIC_FLAG_('c', c_formatter)
+SPDLOG_STATIC_FLAG_('C', C_formatter)
+SPDLOG_STATIC_FLAG_('Y', Y_formatter)
+SPDLOG_STATIC_FLAG_('D', D_formatter)
+SPDLOG_STATIC_FLAG_('x', D_formatter)
+SPDLOG_STATIC_FLAG_('m', m_formatter)
+SPDLOG_STATIC_FLAG_('d', d_formatter)
+SPDLOG_STATIC_FLAG_('H', H_formatter)
+SPDLOG_STATIC_FLAG_('I', I_formatter)
+SPDLOG_STATIC_FLAG_('M', M_formatter)
+SPDLOG_STATIC_FLAG_('S', S_formatter)
+SPDLOG_STATIC_FLAG_('e', e_formatter)
+SPDLOG_STATIC_FLAG_('f', f_formatter)
+SPDLOG_STATIC_FLAG_('F', F_formatter)
+SPDLOG_STATIC_FLAG_('E', E_formatter)
+SPDLOG_STATIC_FLAG_('p', p_formatter)
+SPDLOG_STATIC_FLAG_('r', r_formatter)
+SPDLOG_STATIC_FLAG_('R', R_formatter)
+SPDLOG_STATIC_FLAG_('T', T_formatter)
+SPDLOG_STATIC_FLAG_('X', T_formatter)
+SPDLOG_STATIC_FLAG_('z', z_formatter)
+SPDLOG_STATIC_FLAG_('+', full_formatter)
+SPDLOG_STATIC_FLAG_('P', pid_formatter)
+#ifdef SPDLOG_ENABLE_MESSAGE_COUNTER
+SPDLOG_STATIC_FLAG_('i', i_formatter)
+#endif
+SPDLOG_STATIC_FLAG_('^', color_start_formatter)
+SPDLOG_STATIC_FLAG_('$', color_stop_formatter)
+SPDLOG_STATIC_FLAG_('\0', static_chars<>) // trailing '%' is dropped
+
+#undef SPDLOG_STATIC_FLAG_
+
+// the formatters of the pattern, in order. format() calls each of them in turn
+template<typename... Formatters>
+struct static_flags;
+
+template<>
+struct static_flags<>
+{
+    void format(const log_msg &, const std::tm &, fmt::memory_buffer &)
+    {
+    }
+};
+
+template<typename First, typename... Rest>
+struct static_flags<First, Rest...>
+{
+    void format(const log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest)
+    {
+        first_.format(msg, tm_time, dest);
+        rest_.format(msg, tm_time, dest);
+    }
+
+    First first_;
+    static_flags<Rest...> rest_;
+};
+
+template<char... Chars>
+struct pattern_chars
+{
+};
+
+// parse the pattern chars into static_flags<..>.
+// Literal is the run of user chars found so far, Formatters the formatters before it.
+template<typename Chars, typename Literal, typename... Formatters>
+struct static_pattern_parser;
+
+template<typename Literal, typename... Formatters>
+struct static_pattern_parser<pattern_chars<>, Literal, Formatters...>
+{
+    using type = static_flags<Formatters..., Literal>;
+};
+
+// end of the string literal
+template<char... Rest, char... Literal, typename... Formatters>
+struct static_pattern_parser<pattern_chars<'\0', Rest...>, static_chars<Literal...>, Formatters...>
+    : static_pattern_parser<pattern_chars<>, static_chars<Literal...>, Formatters...>
+{
+};
+
+template<char Flag, char... Rest, char... Literal, typename... Formatters>
+struct static_pattern_parser<pattern_chars<'%', Flag, Rest...>, static_chars<Literal...>, Formatters...>
+    : static_pattern_parser<pattern_chars<Rest...>, static_chars<>, Formatters..., static_chars<Literal...>, typename static_flag<Flag>::type>
+{
+};
+
+template<char Ch, char... Rest, char... Literal, typename... Formatters>
+struct static_pattern_parser<pattern_chars<Ch, Rest...>, static_chars<Literal...>, Formatters...>
+    : static_pattern_parser<pattern_chars<Rest...>, static_chars<Literal..., Ch>, Formatters...>
+{
+};
+
+template<size_t Size, char... Chars>
+struct static_pattern
+{
+    static_assert(Size <= 128, "SPDLOG_STATIC_PATTERN: pattern too long (max 127 chars)");
+    using type = typename static_pattern_parser<pattern_chars<Chars...>, static_chars<>>::type;
+};
+
+template<size_t N>
+constexpr char pattern_char_at(const char (&pattern)[N], size_t i)
+{
+    return i < N ? pattern[i] : '\0';
+}
+
+} // namespace details
+
+template<typename Flags>
+class static_pattern_formatter final : public formatter
+{
+public:
+    explicit static_pattern_formatter(
+        pattern_time_type time_type = pattern_time_type::local, std::string eol = spdlog::details::os::default_eol)
+        : eol_(std::move(eol))
+        , pattern_time_type_(time_type)
+        , last_log_secs_(std::chrono::seconds::min()) // no second cached yet
+    {
+        std::memset(&cached_tm_, 0, sizeof(cached_tm_));
+    }
+
+    static_pattern_formatter(const static_pattern_formatter &other) = delete;
+    static_pattern_formatter &operator=(const static_pattern_formatter &other) = delete;
+
+    std::unique_ptr<formatter> clone() const override
+    {
+        return details::make_unique<static_pattern_formatter>(pattern_time_type_, eol_);
+    }
+
+    void format(const details::log_msg &msg, fmt::memory_buffer &dest) override
+    {
+#ifndef SPDLOG_NO_DATETIME
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(msg.time.time_since_epoch());
+        if (secs != last_log_secs_)
+        {
+            cached_tm_ = get_time_(msg);
+            last_log_secs_ = secs;
+        }
+#endif
+        flags_.format(msg, cached_tm_, dest);
+        details::fmt_helper::append_string_view(eol_, dest);
+    }
+
+private:
+    std::string eol_;
+    pattern_time_type pattern_time_type_;
+    std::tm cached_tm_;
+    std::chrono::seconds last_log_secs_;
+    Flags flags_;
+
+    std::tm get_time_(const details::log_msg &msg)
+    {
+        if (pattern_time_type_ == pattern_time_type::local)
+        {
+            return details::time_converter::instance().localtime(log_clock::to_time_t(msg.time));
+        }
+        return details::time_converter::gmtime(log_clock::to_time_t(msg.time));
+    }
+};
+} // namespace spdlog
+
+#define SPDLOG_PATTERN_CHAR_(s, i) ::spdlog::details::pattern_char_at(s, i)
+#define SPDLOG_PATTERN_CHARS4_(s, i)                                                                                                       \
+    SPDLOG_PATTERN_CHAR_(s, i), SPDLOG_PATTERN_CHAR_(s, i + 1), SPDLOG_PATTERN_CHAR_(s, i + 2), SPDLOG_PATTERN_CHAR_(s, i + 3)
+#define SPDLOG_PATTERN_CHARS16_(s, i)                                                                                                      \
+    SPDLOG_PATTERN_CHARS4_(s, i), SPDLOG_PATTERN_CHARS4_(s, i + 4), SPDLOG_PATTERN_CHARS4_(s, i + 8), SPDLOG_PATTERN_CHARS4_(s, i + 12)
+#define SPDLOG_PATTERN_CHARS64_(s, i)                                                                                                      \
+    SPDLOG_PATTERN_CHARS16_(s, i), SPDLOG_PATTERN_CHARS16_(s, i + 16), SPDLOG_PATTERN_CHARS16_(s, i + 32),                                 \
+        SPDLOG_PATTERN_CHARS16_(s, i + 48)
+
+#define SPDLOG_STATIC_PATTERN(pattern)                                                                                                     \
+    ::spdlog::static_pattern_formatter<::spdlog::details::static_pattern<sizeof(pattern), SPDLOG_PATTERN_CHARS64_(pattern, 0),   \
+        SPDLOG_PATTERN_CHARS64_(pattern, 64)>::type>
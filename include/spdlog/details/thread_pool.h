@@ -1,13 +1,22 @@
 #pragma once
 
+#include "spdlog/details/deferred_args.h"
 #include "spdlog/details/fmt_helper.h"
 #include "spdlog/details/log_msg.h"
 #include "spdlog/details/mpmc_blocking_q.h"
+#include "spdlog/details/mpmc_lockfree_q.h"
 #include "spdlog/details/os.h"
+#include "spdlog/details/payload_slab.h"
+#include "spdlog/details/per_thread_q.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace spdlog {
@@ -19,21 +28,30 @@ enum class async_msg_type
 {
     log,
     flush,
+    release, // the logger is no longer used by the application, see thread_pool::collect_loggers_()
+             // (msg_id is the release id)
     terminate
 };
 
 // Async msg to move to/from the queue
 // Movable only. should never be copied
+// the logger is referenced by a raw pointer, the thread pool keeps it alive while it has
+// messages in the queue.
 struct async_msg
 {
     async_msg_type msg_type;
     level::level_enum level;
     log_clock::time_point time;
+    std::uint64_t clock_ticks; // see log_msg
     size_t thread_id;
-    fmt::basic_memory_buffer<char, 176> raw;
+    async_payload raw;
 
     size_t msg_id;
-    async_logger_ptr worker_ptr;
+    async_logger *worker_ptr;
+
+    // deferred formatting: raw holds the captured arguments instead of the text (see log_msg)
+    const char *deferred_fmt;
+    const deferred_format_info *deferred_info;
 
     async_msg() = default;
     ~async_msg() = default;
@@ -46,10 +64,13 @@ struct async_msg
     async_msg(async_msg &&other) SPDLOG_NOEXCEPT : msg_type(other.msg_type),
                                                    level(other.level),
                                                    time(other.time),
+                                                   clock_ticks(other.clock_ticks),
                                                    thread_id(other.thread_id),
-                                                   raw(move(other.raw)),
+                                                   raw(std::move(other.raw)),
                                                    msg_id(other.msg_id),
-                                                   worker_ptr(std::move(other.worker_ptr))
+                                                   worker_ptr(other.worker_ptr),
+                                                   deferred_fmt(other.deferred_fmt),
+                                                   deferred_info(other.deferred_info)
     {
     }
 
@@ -58,10 +79,13 @@ struct async_msg
         msg_type = other.msg_type;
         level = other.level;
         time = other.time;
+        clock_ticks = other.clock_ticks;
         thread_id = other.thread_id;
         raw = std::move(other.raw);
         msg_id = other.msg_id;
-        worker_ptr = std::move(other.worker_ptr);
+        worker_ptr = other.worker_ptr;
+        deferred_fmt = other.deferred_fmt;
+        deferred_info = other.deferred_info;
         return *this;
     }
 #else // (_MSC_VER) && _MSC_VER <= 1800
@@ -69,21 +93,37 @@ struct async_msg
     async_msg &operator=(async_msg &&) = default;
 #endif
 
-    // construct from log_msg with given type
-    async_msg(async_logger_ptr &&worker, async_msg_type the_type, details::log_msg &&m)
+    // construct from log_msg with given type.
+    // payloads that don't fit inline are copied to a block of the given slab.
+    async_msg(async_logger *worker, async_msg_type the_type, details::log_msg &&m, payload_slab *slab = nullptr)
         : msg_type(the_type)
         , level(m.level)
         , time(m.time)
+        , clock_ticks(m.clock_ticks)
         , thread_id(m.thread_id)
         , msg_id(m.msg_id)
-        , worker_ptr(std::move(worker))
+        , worker_ptr(worker)
+        , deferred_fmt(m.deferred_fmt)
+        , deferred_info(m.deferred_info)
     {
-        fmt_helper::append_string_view(m.payload, raw);
+        auto &bytes = m.deferred_info != nullptr ? m.deferred_args : m.payload;
+        raw.assign(bytes.data(), bytes.size(), slab);
+#if defined(SPDLOG_PER_THREAD_QUEUE)
+        // the queues are merged by time, so it's needed now
+        if (clock_ticks != 0)
+        {
+            time = tsc_clock::to_time_point(clock_ticks);
+            clock_ticks = 0;
+        }
+#endif
     }
 
-    async_msg(async_logger_ptr &&worker, async_msg_type the_type)
-        : async_msg(std::move(worker), the_type, details::log_msg())
+    // control messages are stamped too, so the per thread queues merge them in order.
+    // release messages are stamped last, so they are merged after the pending log messages.
+    async_msg(async_logger *worker, async_msg_type the_type)
+        : async_msg(worker, the_type, details::log_msg())
     {
+        time = the_type == async_msg_type::release ? log_clock::time_point::max() : os::now();
     }
 
     explicit async_msg(async_msg_type the_type)
@@ -94,24 +134,70 @@ struct async_msg
     // copy into log_msg
     log_msg to_log_msg()
     {
-        log_msg msg(&worker_ptr->name(), level, string_view_t(raw.data(), raw.size()));
-        msg.time = time;
-        msg.thread_id = thread_id;
+        return to_log_msg(deferred_info != nullptr ? string_view_t() : string_view_t(raw.data(), raw.size()));
+    }
+
+    // copy into log_msg with the given text (formatted from the captured arguments)
+    log_msg to_log_msg(string_view_t payload)
+    {
+        log_msg msg(&worker_ptr->name(), level, payload, clock_ticks != 0 ? tsc_clock::to_time_point(clock_ticks) : time, thread_id);
         msg.msg_id = msg_id;
         msg.color_range_start = 0;
         msg.color_range_end = 0;
+        if (deferred_info != nullptr)
+        {
+            msg.deferred_fmt = deferred_fmt;
+            msg.deferred_info = deferred_info;
+            msg.deferred_args = string_view_t(raw.data(), raw.size());
+        }
         return msg;
     }
 };
 
+// merge order of the per thread queues: log time, then message id.
+// terminate messages go last, so they are picked only after the other queues are drained
+// (release messages are stamped with the max time point for the same reason).
+struct async_msg_before
+{
+    bool operator()(const async_msg &lhs, const async_msg &rhs) const
+    {
+        bool lhs_terminate = lhs.msg_type == async_msg_type::terminate;
+        bool rhs_terminate = rhs.msg_type == async_msg_type::terminate;
+        if (lhs_terminate != rhs_terminate)
+        {
+            return rhs_terminate;
+        }
+        if (lhs.time != rhs.time)
+        {
+            return lhs.time < rhs.time;
+        }
+        return lhs.msg_id < rhs.msg_id;
+    }
+};
+
 class thread_pool
 {
 public:
     using item_type = async_msg;
+#if defined(SPDLOG_PER_THREAD_QUEUE)
+    using q_type = details::per_thread_queue<item_type, async_msg_before>;
+#elif defined(SPDLOG_LOCKFREE_QUEUE)
+    using q_type = details::mpmc_lockfree_queue<item_type>;
+#else
     using q_type = details::mpmc_blocking_queue<item_type>;
+#endif
+
+    // max number of messages a worker thread dequeues at once
+    static const size_t max_batch_size = 64;
+
+    // payloads longer than async_payload::inline_size are copied to slab blocks of this size.
+    // there is a block for each queue slot and each message in the workers' batches, longer
+    // payloads are allocated on the heap.
+    static const size_t slab_block_size = 512;
 
     thread_pool(size_t q_max_items, size_t threads_n)
-        : q_(q_max_items)
+        : slab_(slab_block_size, q_max_items + threads_n * max_batch_size)
+        , q_(q_max_items)
     {
         // std::cout << "thread_pool()  q_size_bytes: " << q_size_bytes <<
         // "\tthreads_n: " << threads_n << std::endl;
@@ -120,13 +206,21 @@ public:
             throw spdlog_ex("spdlog::thread_pool(): invalid threads_n param (valid "
                             "range is 1-1000)");
         }
+        workers_n_ = threads_n;
+        worker_epochs_.reset(new std::atomic<size_t>[threads_n]);
         for (size_t i = 0; i < threads_n; i++)
         {
-            threads_.emplace_back(&thread_pool::worker_loop_, this);
+            worker_epochs_[i].store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < threads_n; i++)
+        {
+            threads_.emplace_back(&thread_pool::worker_loop_, this, i);
         }
     }
 
-    // message all threads to terminate gracefully join them
+    // message all threads to terminate gracefully join them.
+    // the loggers still attached find the pool gone on their next message (they must not be
+    // logging meanwhile: they post through a raw pointer to the pool)
     ~thread_pool()
     {
         try
@@ -144,83 +238,353 @@ public:
         catch (...)
         {
         }
+
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        for (auto &entry : loggers_)
+        {
+            entry.first->attached_pool_.store(nullptr, std::memory_order_release);
+        }
     }
 
     thread_pool(const thread_pool &) = delete;
     thread_pool &operator=(thread_pool &&) = delete;
 
-    void post_log(async_logger_ptr &&worker_ptr, details::log_msg &&msg, async_overflow_policy overflow_policy)
+    // keep the logger alive while it has messages in the queue (they refer to it by raw pointer).
+    // called by the logger before posting while not attached: on its first message, and when
+    // used again after the pool started releasing it (which cancels the release).
+    void attach_logger(async_logger_ptr &&worker_ptr)
     {
-        async_msg async_m(std::move(worker_ptr), async_msg_type::log, std::move(msg));
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        auto *key = worker_ptr.get();
+        auto &attached = loggers_[key];
+        if (!attached.ptr)
+        {
+            attached.ptr = std::move(worker_ptr);
+        }
+        attached.state = attach_state::attached;
+        key->attached_pool_.store(this, std::memory_order_release);
+    }
+
+    void post_log(async_logger *worker_ptr, details::log_msg &&msg, async_overflow_policy overflow_policy)
+    {
+        async_msg async_m(worker_ptr, async_msg_type::log, std::move(msg), &slab_);
         post_async_msg_(std::move(async_m), overflow_policy);
     }
 
-    void post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy)
+    // flush requests are never dropped: they wait for room in the queue whatever the overflow
+    // policy of the logger
+    void post_flush(async_logger *worker_ptr)
     {
-        post_async_msg_(async_msg(std::move(worker_ptr), async_msg_type::flush), overflow_policy);
+        post_async_msg_(async_msg(worker_ptr, async_msg_type::flush), async_overflow_policy::block);
     }
 
+    // number of log messages dropped on a full queue (overrun, or discarded by discard_new)
     size_t overrun_counter()
     {
-        return q_.overrun_counter();
+        return q_.overrun_counter() + discarded_counter_.load(std::memory_order_relaxed);
     }
 
 private:
+    // a logger only referenced by the pool is released in two steps, see collect_loggers_()
+    enum class attach_state
+    {
+        attached,
+        draining, // attached_pool_ reset, first release message posted
+        quiescing // second release message posted
+    };
+
+    struct attached_logger
+    {
+        async_logger_ptr ptr;
+        attach_state state = attach_state::attached;
+        size_t release_id = 0; // of the last release message posted
+    };
+
+    // logger released by a worker. dropped once the other workers left the batch they were
+    // processing at the time (epochs are their worker_epochs_ at that time).
+    struct released_logger
+    {
+        async_logger_ptr ptr;
+        std::vector<size_t> epochs;
+    };
+
+    struct worker_context
+    {
+        size_t index;
+        std::vector<async_msg> batch;
+        std::vector<details::log_msg> log_msgs;
+        fmt::memory_buffer formatted;  // text of the deferred formatting messages
+        std::vector<size_t> text_ends; // end of each text in formatted
+        std::vector<released_logger> released;
+        std::chrono::steady_clock::time_point last_collect;
+    };
+
+    // declared before the queue: the queued messages return their blocks on destruction
+    payload_slab slab_;
+
+    std::mutex loggers_mutex_;
+    std::unordered_map<async_logger *, attached_logger> loggers_;
+    std::vector<async_logger_ptr> retired_loggers_; // released by exited workers
+
     q_type q_;
 
     std::vector<std::thread> threads_;
 
+    // incremented by each worker after processing a batch
+    size_t workers_n_ = 0;
+    std::unique_ptr<std::atomic<size_t>[]> worker_epochs_;
+
+    std::atomic<size_t> discarded_counter_{0}; // by discard_new
+
     void post_async_msg_(async_msg &&new_msg, async_overflow_policy overflow_policy)
     {
-        if (overflow_policy == async_overflow_policy::block)
+        switch (overflow_policy)
         {
+        case async_overflow_policy::block:
             q_.enqueue(std::move(new_msg));
-        }
-        else
-        {
+            break;
+        case async_overflow_policy::overrun_oldest:
             q_.enqueue_nowait(std::move(new_msg));
+            break;
+        case async_overflow_policy::discard_new:
+            if (!q_.try_enqueue(std::move(new_msg)))
+            {
+                discarded_counter_.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
         }
     }
 
-    void worker_loop_()
+    void worker_loop_(size_t index)
     {
-        while (process_next_msg_()) {};
+        worker_context ctx;
+        ctx.index = index;
+        ctx.batch.resize(max_batch_size);
+        ctx.log_msgs.reserve(max_batch_size);
+        ctx.last_collect = std::chrono::steady_clock::now();
+        while (process_next_batch_(ctx)) {};
+
+        // the other workers may still process messages of the released loggers
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        for (auto &r : ctx.released)
+        {
+            retired_loggers_.push_back(std::move(r.ptr));
+        }
     }
 
-    // process next message in the queue
+    // process the next batch of messages in the queue (up to max_batch_size, dequeued at once).
+    // consecutive log messages of the same logger are passed to its sinks as a single batch.
     // return true if this thread should still be active (while no terminate msg
     // was received)
-    bool process_next_msg_()
+    bool process_next_batch_(worker_context &ctx)
     {
-        async_msg incoming_async_msg;
-        bool dequeued = q_.dequeue_for(incoming_async_msg, std::chrono::seconds(10));
-        if (!dequeued)
+        auto &batch = ctx.batch;
+        auto &log_msgs = ctx.log_msgs;
+        size_t count = q_.dequeue_bulk_for(batch.data(), batch.size(), std::chrono::seconds(10));
+        size_t terminate_count = 0;
+        for (size_t i = 0; i < count;)
         {
-            return true;
+            auto &incoming_async_msg = batch[i];
+            switch (incoming_async_msg.msg_type)
+            {
+            case async_msg_type::log:
+            {
+                size_t end = i + 1;
+                while (end < count && batch[end].msg_type == async_msg_type::log && batch[end].worker_ptr == incoming_async_msg.worker_ptr)
+                {
+                    ++end;
+                }
+                format_deferred_(ctx, i, end);
+                log_msgs.clear();
+                size_t text_pos = 0;
+                auto text_end = ctx.text_ends.begin();
+                for (size_t j = i; j < end; j++)
+                {
+                    if (batch[j].deferred_info == nullptr)
+                    {
+                        log_msgs.push_back(batch[j].to_log_msg());
+                        continue;
+                    }
+                    log_msgs.push_back(batch[j].to_log_msg(string_view_t(ctx.formatted.data() + text_pos, *text_end - text_pos)));
+                    text_pos = *text_end++;
+                }
+                incoming_async_msg.worker_ptr->backend_log_batch_(log_msgs.data(), log_msgs.size());
+                i = end;
+                continue;
+            }
+            case async_msg_type::flush:
+            {
+                incoming_async_msg.worker_ptr->backend_flush_();
+                break;
+            }
+
+            case async_msg_type::release:
+            {
+                release_logger_(ctx, incoming_async_msg);
+                break;
+            }
+
+            case async_msg_type::terminate:
+            {
+                ++terminate_count;
+                break;
+            }
+            default:
+                assert(false && "Unexpected async_msg_type");
+            }
+            ++i;
         }
 
-        switch (incoming_async_msg.msg_type)
+        worker_epochs_[ctx.index].store(worker_epochs_[ctx.index].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        drop_released_loggers_(ctx);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - ctx.last_collect >= std::chrono::seconds(1))
         {
-        case async_msg_type::log:
+            ctx.last_collect = now;
+            collect_loggers_();
+        }
+
+        // terminate messages meant for the other threads go back to the queue
+        for (size_t i = 1; i < terminate_count; i++)
         {
-            auto msg = incoming_async_msg.to_log_msg();
-            incoming_async_msg.worker_ptr->backend_log_(msg);
-            return true;
+            post_async_msg_(async_msg(async_msg_type::terminate), async_overflow_policy::block);
         }
-        case async_msg_type::flush:
+        return terminate_count == 0;
+    }
+
+    // format the deferred formatting messages in batch[begin, end) (all of the same logger).
+    // the texts are stored one after the other, and referenced by the log_msgs once all are
+    // formatted (the buffer might grow meanwhile).
+    // texts are left empty if none of the logger's sinks needs them.
+    void format_deferred_(worker_context &ctx, size_t begin, size_t end)
+    {
+        ctx.formatted.resize(0);
+        ctx.text_ends.clear();
+        bool needs_text = true;
+        bool needs_text_checked = false;
+        for (size_t j = begin; j < end; j++)
         {
-            incoming_async_msg.worker_ptr->backend_flush_();
-            return true;
+            auto &m = ctx.batch[j];
+            if (m.deferred_info == nullptr)
+            {
+                continue;
+            }
+            if (!needs_text_checked)
+            {
+                needs_text = m.worker_ptr->backend_needs_deferred_text_();
+                needs_text_checked = true;
+            }
+            if (needs_text)
+            {
+                m.worker_ptr->backend_format_(m.to_log_msg(), ctx.formatted);
+            }
+            ctx.text_ends.push_back(ctx.formatted.size());
         }
+    }
 
-        case async_msg_type::terminate:
+    // start releasing the loggers only referenced by the pool.
+    // such a logger can still be used again (revived by weak_ptr::lock, e.g. from the registry),
+    // so it is released in two steps:
+    // 1. its attached_pool_ is reset and a first release message is posted. from then on, the
+    //    logger attaches again before posting, which cancels the release. threads that passed the
+    //    attached_pool_ check before may still be posting.
+    // 2. when the first release message is dequeued, if the pool still holds the only reference,
+    //    those threads are done posting (they held a reference meanwhile). a second release
+    //    message is posted behind their messages, and the logger is dropped once it is dequeued.
+    void collect_loggers_()
+    {
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        for (auto &entry : loggers_)
         {
-            return false;
+            auto &attached = entry.second;
+            if (attached.state != attach_state::attached || attached.ptr.use_count() != 1)
+            {
+                continue;
+            }
+            // synchronize with the last release of the logger by the application
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            entry.first->attached_pool_.store(nullptr, std::memory_order_seq_cst);
+            if (post_release_(attached))
+            {
+                attached.state = attach_state::draining;
+            }
+            else
+            {
+                entry.first->attached_pool_.store(this, std::memory_order_release);
+            }
         }
+    }
+
+    // don't block the worker on a full queue, the release is tried again on next collect
+    bool post_release_(attached_logger &attached)
+    {
+        async_msg release_msg(attached.ptr.get(), async_msg_type::release);
+        release_msg.msg_id = attached.release_id + 1;
+        if (!q_.try_enqueue(std::move(release_msg)))
+        {
+            return false;
         }
-        assert(false && "Unexpected async_msg_type");
+        ++attached.release_id;
         return true;
     }
+
+    // a release message was dequeued (ignored if the logger attached again since it was posted).
+    // on the second one, other workers might still process messages of this logger dequeued
+    // before it, so drop it only after they finished their current batch.
+    void release_logger_(worker_context &ctx, const async_msg &release_msg)
+    {
+        released_logger released;
+        {
+            std::lock_guard<std::mutex> lock(loggers_mutex_);
+            auto it = loggers_.find(release_msg.worker_ptr);
+            if (it == loggers_.end() || it->second.state == attach_state::attached || it->second.release_id != release_msg.msg_id)
+            {
+                return;
+            }
+            auto &attached = it->second;
+            if (attached.state == attach_state::draining)
+            {
+                if (attached.ptr.use_count() == 1)
+                {
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (post_release_(attached))
+                    {
+                        attached.state = attach_state::quiescing;
+                        return;
+                    }
+                }
+                // in use again, or the queue is full: cancel, try again on next collect
+                attached.state = attach_state::attached;
+                release_msg.worker_ptr->attached_pool_.store(this, std::memory_order_release);
+                return;
+            }
+            released.ptr = std::move(attached.ptr);
+            loggers_.erase(it);
+        }
+        released.epochs.reserve(workers_n_);
+        for (size_t i = 0; i < workers_n_; i++)
+        {
+            released.epochs.push_back(worker_epochs_[i].load(std::memory_order_acquire));
+        }
+        ctx.released.push_back(std::move(released));
+    }
+
+    void drop_released_loggers_(worker_context &ctx)
+    {
+        auto quiescent = [&](const released_logger &r) {
+            for (size_t i = 0; i < r.epochs.size(); i++)
+            {
+                if (i != ctx.index && worker_epochs_[i].load(std::memory_order_acquire) == r.epochs[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        ctx.released.erase(std::remove_if(ctx.released.begin(), ctx.released.end(), quiescent), ctx.released.end());
+    }
 };
 
 } // namespace details
@@ -0,0 +1,220 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Process wide epoch seconds -> std::tm conversion for the formatters.
+//
+// gmtime(..) is pure arithmetic (days -> civil date).
+// localtime(..) adds the cached UTC offset and does the same. The offset is cached together
+// with the interval it's valid for: the local day (or hour) around the last converted time,
+// when the zone is the same at both ends of it. Only a time outside the interval (next day,
+// DST transition) calls os::localtime (which takes the libc timezone lock) to refresh the cache.
+// The cache is a seqlock: readers don't lock, and retry if a refresh happened meanwhile.
+
+#include "spdlog/details/os.h"
+
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <mutex>
+
+namespace spdlog {
+namespace details {
+
+class time_converter
+{
+public:
+    static time_converter &instance()
+    {
+        static time_converter converter;
+        return converter;
+    }
+
+    time_converter(const time_converter &) = delete;
+    time_converter &operator=(const time_converter &) = delete;
+
+    std::tm localtime(std::time_t t)
+    {
+        long long offset;
+        int isdst;
+        const char *zone;
+        read_(t, offset, isdst, zone);
+        std::tm tm = to_tm(static_cast<long long>(t) + offset);
+        tm.tm_isdst = isdst;
+        set_zone_(tm, offset, zone);
+        return tm;
+    }
+
+    // UTC offset (seconds) of the local time at t
+    long long utc_offset(std::time_t t)
+    {
+        long long offset;
+        int isdst;
+        const char *zone;
+        read_(t, offset, isdst, zone);
+        return offset;
+    }
+
+    static std::tm gmtime(std::time_t t)
+    {
+        std::tm tm = to_tm(t);
+        set_zone_(tm, 0, "GMT");
+        return tm;
+    }
+
+    // broken down time of the given seconds since epoch (no timezone)
+    static std::tm to_tm(long long secs)
+    {
+        long long days = floor_div_(secs, 86400);
+        long long rem = secs - days * 86400;
+
+        // civil_from_days (http://howardhinnant.github.io/date_algorithms.html)
+        long long z = days + 719468;
+        long long era = floor_div_(z, 146097);
+        long long doe = z - era * 146097;                                     // [0, 146096]
+        long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+        long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);              // [0, 365], from March 1st
+        long long mp = (5 * doy + 2) / 153;                                   // [0, 11], from March
+        long long year = yoe + era * 400 + (mp >= 10 ? 1 : 0);
+        int month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9); // [1, 12]
+
+        std::tm tm{};
+        tm.tm_year = static_cast<int>(year - 1900);
+        tm.tm_mon = month - 1;
+        tm.tm_mday = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+        tm.tm_hour = static_cast<int>(rem / 3600);
+        tm.tm_min = static_cast<int>(rem % 3600 / 60);
+        tm.tm_sec = static_cast<int>(rem % 60);
+        tm.tm_wday = static_cast<int>(days - floor_div_(days + 4, 7) * 7 + 4); // 1970-01-01 was a thursday
+        tm.tm_yday = static_cast<int>(days - days_from_civil_(year, 1, 1));
+        return tm;
+    }
+
+private:
+    time_converter() = default;
+
+    void read_(std::time_t t, long long &offset, int &isdst, const char *&zone)
+    {
+        long long secs = t;
+        for (;;)
+        {
+            auto seq = seq_.load(std::memory_order_acquire);
+            long long from = from_.load(std::memory_order_relaxed);
+            long long until = until_.load(std::memory_order_relaxed);
+            offset = offset_.load(std::memory_order_relaxed);
+            isdst = isdst_.load(std::memory_order_relaxed);
+            zone = zone_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((seq & 1) != 0 || seq != seq_.load(std::memory_order_relaxed))
+            {
+                continue; // refresh in progress
+            }
+            if (secs >= from && secs < until)
+            {
+                return;
+            }
+            refresh_(t);
+        }
+    }
+
+    static long long floor_div_(long long a, long long b)
+    {
+        return a / b - ((a % b != 0 && ((a < 0) != (b < 0))) ? 1 : 0);
+    }
+
+    static long long days_from_civil_(long long y, int m, int d)
+    {
+        y -= m <= 2 ? 1 : 0;
+        long long era = floor_div_(y, 400);
+        long long yoe = y - era * 400;
+        long long doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    static void set_zone_(std::tm &tm, long long offset, const char *zone)
+    {
+#if !defined(_WIN32) && !defined(sun) && !defined(__sun) && !defined(_AIX)
+        tm.tm_gmtoff = static_cast<long>(offset);
+        tm.tm_zone = const_cast<char *>(zone);
+#else
+        (void)tm;
+        (void)offset;
+        (void)zone;
+#endif
+    }
+
+    static const char *zone_of_(const std::tm &tm)
+    {
+#if !defined(_WIN32) && !defined(sun) && !defined(__sun) && !defined(_AIX)
+        return tm.tm_zone;
+#else
+        (void)tm;
+        return nullptr;
+#endif
+    }
+
+    // the broken down local time as seconds since epoch
+    static long long local_secs_(const std::tm &tm)
+    {
+        return days_from_civil_(tm.tm_year + 1900LL, tm.tm_mon + 1, tm.tm_mday) * 86400 + tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    }
+
+    // whether the local time at t has the given offset, dst flag and zone name
+    static bool same_zone_at_(long long t, long long offset, const std::tm &tm)
+    {
+        std::tm other = os::localtime(static_cast<std::time_t>(t));
+        const char *zone = zone_of_(tm);
+        const char *other_zone = zone_of_(other);
+        return local_secs_(other) - t == offset && other.tm_isdst == tm.tm_isdst &&
+               (zone == other_zone || (zone != nullptr && other_zone != nullptr && std::strcmp(zone, other_zone) == 0));
+    }
+
+    void refresh_(std::time_t t)
+    {
+        long long secs = t;
+        std::tm tm = os::localtime(t);
+        long long offset = local_secs_(tm) - secs;
+
+        // the local day around t, if the zone (offset, dst, name) doesn't change during it.
+        // otherwise the local hour, otherwise this second only.
+        long long from = secs;
+        long long until = secs + 1;
+        for (long long period : {86400LL, 3600LL})
+        {
+            long long start = floor_div_(secs + offset, period) * period - offset;
+            if (same_zone_at_(start, offset, tm) && same_zone_at_(start + period - 1, offset, tm))
+            {
+                from = start;
+                until = start + period;
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        from_.store(from, std::memory_order_relaxed);
+        until_.store(until, std::memory_order_relaxed);
+        offset_.store(offset, std::memory_order_relaxed);
+        isdst_.store(tm.tm_isdst, std::memory_order_relaxed);
+        zone_.store(zone_of_(tm), std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    std::mutex mutex_; // serializes the refreshes
+    std::atomic<unsigned> seq_{0};
+    std::atomic<long long> from_{0}; // [from_, until_) - seconds the offset is valid for
+    std::atomic<long long> until_{0};
+    std::atomic<long long> offset_{0};
+    std::atomic<int> isdst_{0};
+    std::atomic<const char *> zone_{nullptr};
+};
+
+} // namespace details
+} // namespace spdlog
@@ -21,6 +21,16 @@
 // char buf[128];
 // logger->info("Some buffer {:X}", spdlog::to_hex(std::begin(buf), std::end(buf)));
 
+#include "spdlog/details/hex_encode.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
 namespace spdlog {
 namespace details {
 
@@ -46,6 +56,20 @@ public:
 private:
     It begin_, end_;
 };
+
+// iterators of contiguous bytes (copied with memcpy by the formatter)
+template<typename It>
+struct is_contiguous_iterator
+{
+    using value_type = typename std::remove_cv<typename std::iterator_traits<It>::value_type>::type;
+    static const bool value =
+        std::is_pointer<It>::value ||
+        (!std::is_same<value_type, bool>::value &&
+            (std::is_same<It, typename std::vector<value_type>::iterator>::value ||
+                std::is_same<It, typename std::vector<value_type>::const_iterator>::value ||
+                std::is_same<It, typename std::basic_string<value_type>::iterator>::value ||
+                std::is_same<It, typename std::basic_string<value_type>::const_iterator>::value));
+};
 } // namespace details
 
 // create a bytes_range that wraps the given container
@@ -107,66 +131,137 @@ struct formatter<spdlog::details::bytes_range<T>>
         return it;
     }
 
-    // format the given bytes range as hex
+    // format the given bytes range as hex.
+    // the text is built in a local buffer, a line (or chunk) of bytes at a time encoded by
+    // details::hex_encode (SIMD on x86-64), and appended to the output every few KB.
     template<typename FormatContext, typename Container>
     auto format(const spdlog::details::bytes_range<Container> &the_range, FormatContext &ctx) -> decltype(ctx.out())
     {
-        SPDLOG_CONSTEXPR const char *hex_upper = "0123456789ABCDEF";
-        SPDLOG_CONSTEXPR const char *hex_lower = "0123456789abcdef";
-        const char *hex_chars = use_uppercase ? hex_upper : hex_lower;
+        static const std::size_t chunk_size = 1024;
+        static const std::size_t max_header_size = 2 + 16 + 2; // newline, position, ": "
+        unsigned char bytes[chunk_size];
+        char text[chunk_size * 4];
+        const char delimiter_char = put_delimiters ? delimiter : '\0';
 
         std::size_t pos = 0;
-        std::size_t column = line_size;
         auto inserter = ctx.begin();
+        auto it = the_range.begin();
+        auto end = the_range.end();
 
-        for (auto &item : the_range)
+        // bytes per line: the first one after the position header, then the ones until the
+        // column reaches line_size
+        std::size_t line_bytes = chunk_size;
+        if (put_newlines)
         {
-            auto ch = static_cast<unsigned char>(item);
-            pos++;
-
-            if (put_newlines && column >= line_size)
+            std::size_t column = (put_positions ? 7 : 1) + 2;
+            for (line_bytes = 1; column < line_size; line_bytes++)
             {
-                column = put_newline(inserter, pos);
-
-                // put first byte without delimiter in front of it
-                *inserter++ = hex_chars[(ch >> 4) & 0x0f];
-                *inserter++ = hex_chars[ch & 0x0f];
-                column += 2;
-                continue;
+                column += put_delimiters ? 3 : 2;
             }
+        }
 
-            if (put_delimiters)
+        char *text_end = text;
+        while (it != end)
+        {
+            std::size_t n = gather(it, end, bytes, line_bytes, typename std::iterator_traits<Container>::iterator_category());
+            if (put_newlines)
             {
-                *inserter++ = delimiter;
-                ++column;
+                text_end = put_newline(text_end, pos + 1);
+                // first byte without delimiter in front of it: the line is encoded with the
+                // delimiters from the last char of the header, which is restored then
+                if (put_delimiters)
+                {
+                    char header_end = text_end[-1];
+                    char *line_start = text_end;
+                    text_end = spdlog::details::hex_encode(bytes, n, line_start - 1, use_uppercase, delimiter_char);
+                    line_start[-1] = header_end;
+                }
+                else
+                {
+                    text_end = spdlog::details::hex_encode(bytes, n, text_end, use_uppercase, '\0');
+                }
             }
+            else
+            {
+                text_end = spdlog::details::hex_encode(bytes, n, text_end, use_uppercase, delimiter_char);
+            }
+            pos += n;
 
-            *inserter++ = hex_chars[(ch >> 4) & 0x0f];
-            *inserter++ = hex_chars[ch & 0x0f];
-            column += 2;
+            if (it == end || static_cast<std::size_t>(text + sizeof(text) - text_end) < max_header_size + line_bytes * 3)
+            {
+                auto &&out = internal::reserve(inserter, static_cast<std::size_t>(text_end - text));
+                out = std::copy(text, text_end, out);
+                text_end = text;
+            }
         }
         return inserter;
     }
 
-    // put newline(and position header)
-    // return the next column
+    // copy up to max_count bytes of the range to dest. return the number copied
+    template<typename It>
+    static std::size_t gather(It &it, It end, unsigned char *dest, std::size_t max_count, std::random_access_iterator_tag)
+    {
+        auto count = static_cast<std::size_t>(end - it);
+        count = count < max_count ? count : max_count;
+        auto diff = static_cast<typename std::iterator_traits<It>::difference_type>(count);
+        if (spdlog::details::is_contiguous_iterator<It>::value)
+        {
+            if (count != 0)
+            {
+                std::memcpy(dest, &*it, count);
+            }
+        }
+        else
+        {
+            std::transform(
+                it, it + diff, dest, [](typename std::iterator_traits<It>::value_type byte) { return static_cast<unsigned char>(byte); });
+        }
+        it += diff;
+        return count;
+    }
+
     template<typename It>
-    std::size_t put_newline(It inserter, std::size_t pos)
+    static std::size_t gather(It &it, It end, unsigned char *dest, std::size_t max_count, std::input_iterator_tag)
+    {
+        std::size_t count = 0;
+        for (; count < max_count && it != end; ++it)
+        {
+            dest[count++] = static_cast<unsigned char>(*it);
+        }
+        return count;
+    }
+
+    // put newline (and position header - at least 4 uppercase hex digits) at dest.
+    // return the end of it
+    char *put_newline(char *dest, std::size_t pos)
     {
 #ifdef _WIN32
-        *inserter++ = '\r';
+        *dest++ = '\r';
 #endif
-        *inserter++ = '\n';
+        *dest++ = '\n';
 
         if (put_positions)
         {
-            fmt::format_to(inserter, "{:<04X}: ", pos - 1);
-            return 7;
-        }
-        else
-        {
-            return 1;
+            pos--;
+            char digits[16];
+            std::size_t count = 0;
+            do
+            {
+                digits[count++] = "0123456789ABCDEF"[pos & 0x0f];
+                pos >>= 4;
+            } while (pos != 0);
+            for (; count < 4; count++)
+            {
+                digits[count] = '0';
+            }
+            while (count != 0)
+            {
+                *dest++ = digits[--count];
+            }
+            *dest++ = ':';
+            *dest++ = ' ';
         }
+        return dest;
     }
 };
 } // namespace fmt
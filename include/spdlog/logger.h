@@ -19,12 +19,15 @@
 // and support customize format per each sink.
 
 #include "spdlog/common.h"
+#include "spdlog/details/log_limiter.h"
 #include "spdlog/formatter.h"
 #include "spdlog/sinks/sink.h"
 
 #include <locale>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace spdlog {
@@ -119,6 +122,17 @@ public:
     template<typename T>
     void critical(const T &msg);
 
+    // log through a call site limiter (details/log_limiter.h), checked before formatting anything.
+    // the first message let through after suppressed ones is preceded by a summary line, or the
+    // summary is logged by the next flush() if the call site doesn't let one through before.
+    template<typename Limiter, typename... Args>
+    void log_limited(Limiter &limiter, level::level_enum lvl, const char *fmt, const Args &... args);
+
+    // log the "suppressed N similar messages" summary of the limiter on the next flush(), if its
+    // count wasn't taken by a call let through meanwhile. the limiter must outlive the logger
+    // (the call site limiters are statics).
+    void report_suppressed_on_flush(details::rate_limiter &limiter, level::level_enum lvl);
+
     bool should_log(level::level_enum msg_level) const;
     void set_level(level::level_enum log_level);
     level::level_enum level() const;
@@ -142,6 +156,10 @@ public:
     void set_error_handler(log_err_handler err_handler);
     log_err_handler error_handler() const;
 
+    // clock of the message times (see clock_policy)
+    void set_clock(clock_policy clock);
+    clock_policy clock() const;
+
     // create new logger with same sinks and configuration.
     virtual std::shared_ptr<logger> clone(std::string logger_name);
 
@@ -151,6 +169,21 @@ protected:
 
     bool should_flush_(const details::log_msg &msg);
 
+    // keep the rate limiters with suppressed calls to report on flush() (nothing for the samplers)
+    void on_suppressed_(details::rate_limiter &limiter, level::level_enum lvl);
+    void on_suppressed_(details::log_sampler &, level::level_enum) {}
+
+    // log the summaries of the limiters registered by report_suppressed_on_flush
+    void log_suppressed_();
+
+    // capture the arguments in binary form, to be formatted by the backend (deferred formatting).
+    // return false if some of the arguments can't be captured, so they are formatted now.
+    template<typename... Args>
+    bool log_deferred_(std::true_type, level::level_enum lvl, const char *fmt, const Args &... args);
+
+    template<typename... Args>
+    bool log_deferred_(std::false_type, level::level_enum lvl, const char *fmt, const Args &... args);
+
     // default error handler: print the error to stderr with the max rate of 1
     // message/minute
     void default_err_handler_(const std::string &msg);
@@ -165,6 +198,10 @@ protected:
     log_err_handler err_handler_;
     std::atomic<time_t> last_err_time_;
     std::atomic<size_t> msg_counter_;
+    bool deferred_formatting_{false};
+    std::atomic<clock_policy> clock_{clock_policy::system};
+    std::mutex suppressed_mutex_;
+    std::vector<std::pair<details::rate_limiter *, level::level_enum>> suppressed_limiters_;
 };
 } // namespace spdlog
 
@@ -10,6 +10,7 @@
 #endif
 
 #include "spdlog/details/console_globals.h"
+#include "spdlog/details/fmt_helper.h"
 #include "spdlog/details/null_mutex.h"
 #include "spdlog/details/os.h"
 #include "spdlog/sinks/sink.h"
@@ -27,6 +28,7 @@ namespace sinks {
  * depending on the severity
  * of the message.
  * If no color terminal detected, omit the escape codes.
+ * Each record (or batch of records from the async logger) is written with a single fwrite.
  */
 template<typename TargetStream, class ConsoleMutex>
 class ansicolor_sink final : public sink
@@ -94,25 +96,21 @@ public:
         // Wrap the originally formatted message in color codes.
         // If color is not supported in the terminal, log as is instead.
         std::lock_guard<mutex_t> lock(mutex_);
+        fmt::memory_buffer formatted;
+        format_(msg, formatted);
+        print_(formatted);
+    }
 
+    // the whole batch in one write
+    void log_batch(const details::log_msg *msgs, size_t count) override
+    {
+        std::lock_guard<mutex_t> lock(mutex_);
         fmt::memory_buffer formatted;
-        formatter_->format(msg, formatted);
-        if (should_do_colors_ && msg.color_range_end > msg.color_range_start)
+        for (size_t i = 0; i < count; i++)
         {
-            // before color range
-            print_range_(formatted, 0, msg.color_range_start);
-            // in color range
-            print_ccode_(colors_[msg.level]);
-            print_range_(formatted, msg.color_range_start, msg.color_range_end);
-            print_ccode_(reset);
-            // after color range
-            print_range_(formatted, msg.color_range_end, formatted.size());
+            format_(msgs[i], formatted);
         }
-        else // no color
-        {
-            print_range_(formatted, 0, formatted.size());
-        }
-        fflush(target_file_);
+        print_(formatted);
     }
 
     void flush() override
@@ -134,13 +132,43 @@ public:
     }
 
 private:
-    void print_ccode_(const std::string &color_code)
+    // append the formatted message to dest, with its color range wrapped in the color codes
+    void format_(const details::log_msg &msg, fmt::memory_buffer &dest)
     {
-        fwrite(color_code.data(), sizeof(char), color_code.size(), target_file_);
+        if (!should_do_colors_)
+        {
+            formatter_->format(msg, dest);
+            return;
+        }
+        // the color range is known once formatted
+        fmt::memory_buffer formatted;
+        formatter_->format(msg, formatted);
+        if (msg.color_range_end > msg.color_range_start)
+        {
+            // before color range
+            append_range_(formatted, 0, msg.color_range_start, dest);
+            // in color range
+            details::fmt_helper::append_string_view(colors_[msg.level], dest);
+            append_range_(formatted, msg.color_range_start, msg.color_range_end, dest);
+            details::fmt_helper::append_string_view(reset, dest);
+            // after color range
+            append_range_(formatted, msg.color_range_end, formatted.size(), dest);
+        }
+        else // no color
+        {
+            details::fmt_helper::append_buf(formatted, dest);
+        }
     }
-    void print_range_(const fmt::memory_buffer &formatted, size_t start, size_t end)
+
+    static void append_range_(const fmt::memory_buffer &formatted, size_t start, size_t end, fmt::memory_buffer &dest)
     {
-        fwrite(formatted.data() + start, sizeof(char), end - start, target_file_);
+        dest.append(formatted.data() + start, formatted.data() + end);
+    }
+
+    void print_(const fmt::memory_buffer &formatted)
+    {
+        fwrite(formatted.data(), sizeof(char), formatted.size(), target_file_);
+        fflush(target_file_);
     }
 
     FILE *target_file_;
@@ -0,0 +1,410 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+#ifndef SPDLOG_H
+#error "spdlog.h must be included before this file."
+#endif
+
+#include "sink.h"
+#include "spdlog/details/log_msg.h"
+#include "spdlog/details/mpmc_blocking_q.h"
+#include "spdlog/details/os.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous distribution sink (fan-out).
+// Each sink (or group of sinks) added to it gets its own worker thread and bounded queue, so a
+// slow sink (network, congested disk..) does not hold up the others.
+//
+// log() copies the message once, to an immutable record (formatted payload, logger name, time..)
+// shared by the queues of all the workers that should log it. The workers pass their records
+// to the sinks in batches (sink::log_batch).
+// flush() posts a flush to each worker and returns without waiting for it.
+// The destructor (or remove_sink) waits for the workers to drain their queues.
+//
+// Each worker has its own overflow policy, used when its queue is full:
+// block          - wait for room in the queue (a congested sink slows down the logging threads)
+// overrun_oldest - drop the oldest record in the queue
+// discard_new    - drop the new record
+// dropped(sink) returns the number of records the worker dropped meanwhile.
+
+namespace spdlog {
+namespace sinks {
+
+class async_dist_sink final : public sink
+{
+public:
+    static const size_t default_queue_size = 8192;
+
+    explicit async_dist_sink(size_t queue_size = default_queue_size)
+        : queue_size_(queue_size)
+        , workers_(std::make_shared<const workers_list>())
+    {
+        if (queue_size_ == 0)
+        {
+            throw spdlog_ex("async_dist_sink: invalid queue size 0");
+        }
+        err_handler_ = default_err_handler_;
+    }
+
+    async_dist_sink(const async_dist_sink &) = delete;
+    async_dist_sink &operator=(const async_dist_sink &) = delete;
+
+    // start a worker for the sink
+    void add_sink(sink_ptr sink, async_overflow_policy overflow_policy = async_overflow_policy::block)
+    {
+        add_sink_group({std::move(sink)}, overflow_policy);
+    }
+
+    // start a worker for the group of sinks (logged to one after the other by the worker)
+    void add_sink_group(std::vector<sink_ptr> group, async_overflow_policy overflow_policy = async_overflow_policy::block)
+    {
+        auto new_worker = std::make_shared<worker>(std::move(group), overflow_policy, queue_size_, err_handler_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto workers = std::make_shared<workers_list>(*std::atomic_load(&workers_));
+        workers->push_back(std::move(new_worker));
+        std::atomic_store(&workers_, std::shared_ptr<const workers_list>(std::move(workers)));
+    }
+
+    // remove the sink. its worker is stopped after writing its queue, and the other sinks of its
+    // group (if any) get a new worker (the two may write to them concurrently meanwhile)
+    void remove_sink(const sink_ptr &sink)
+    {
+        std::shared_ptr<const workers_list> old_workers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            old_workers = std::atomic_load(&workers_);
+            auto workers = std::make_shared<workers_list>();
+            for (auto &w : *old_workers)
+            {
+                if (std::find(w->sinks.begin(), w->sinks.end(), sink) == w->sinks.end())
+                {
+                    workers->push_back(w);
+                    continue;
+                }
+                std::vector<sink_ptr> group;
+                std::copy_if(w->sinks.begin(), w->sinks.end(), std::back_inserter(group), [&](const sink_ptr &s) { return s != sink; });
+                if (!group.empty())
+                {
+                    workers->push_back(std::make_shared<worker>(std::move(group), w->overflow_policy, queue_size_, err_handler_));
+                }
+            }
+            std::atomic_store(&workers_, std::shared_ptr<const workers_list>(std::move(workers)));
+        }
+        // the removed workers stop (in the thread releasing them last) once the logging
+        // threads are done with the old list
+    }
+
+    // number of records dropped by the worker of the sink (0 if not found)
+    size_t dropped(const sink_ptr &sink) const
+    {
+        auto workers = std::atomic_load(&workers_);
+        for (auto &w : *workers)
+        {
+            if (std::find(w->sinks.begin(), w->sinks.end(), sink) != w->sinks.end())
+            {
+                return w->discarded.load(std::memory_order_relaxed) + w->q.overrun_counter();
+            }
+        }
+        return 0;
+    }
+
+    // error handler of the workers (for the exceptions thrown by their sinks).
+    // applies to the workers added afterwards
+    void set_error_handler(log_err_handler err_handler)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        err_handler_ = std::move(err_handler);
+    }
+
+    void log(const details::log_msg &msg) override
+    {
+        auto workers = std::atomic_load(&workers_);
+        std::shared_ptr<const record> rec;
+        for (auto &w : *workers)
+        {
+            if (!w->should_log(msg.level))
+            {
+                continue;
+            }
+            if (!rec)
+            {
+                rec = std::make_shared<const record>(msg);
+            }
+            w->post(item{item_type::log, rec});
+        }
+    }
+
+    void log_batch(const details::log_msg *msgs, size_t count) override
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            log(msgs[i]);
+        }
+    }
+
+    void flush() override
+    {
+        auto workers = std::atomic_load(&workers_);
+        for (auto &w : *workers)
+        {
+            w->post(item{item_type::flush, nullptr});
+        }
+    }
+
+    void set_pattern(const std::string &pattern) override
+    {
+        set_formatter(details::make_unique<spdlog::pattern_formatter>(pattern));
+    }
+
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &w : *std::atomic_load(&workers_))
+        {
+            for (auto &s : w->sinks)
+            {
+                s->set_formatter(sink_formatter->clone());
+            }
+        }
+        formatter_ = std::move(sink_formatter);
+    }
+
+private:
+    // the message, owned and immutable (shared by the queues of the workers)
+    struct record
+    {
+        explicit record(const details::log_msg &msg)
+            : logger_name(msg.logger_name != nullptr ? *msg.logger_name : std::string())
+            , level(msg.level)
+            , time(msg.time)
+            , thread_id(msg.thread_id)
+            , msg_id(msg.msg_id)
+            , payload(msg.payload.data(), msg.payload.size())
+        {
+        }
+
+        const std::string logger_name;
+        const level::level_enum level;
+        const log_clock::time_point time;
+        const size_t thread_id;
+        const size_t msg_id;
+        const std::string payload;
+    };
+
+    enum class item_type
+    {
+        log,
+        flush,
+        terminate
+    };
+
+    struct item
+    {
+        item() = default;
+
+        item(item_type the_type, std::shared_ptr<const record> the_rec)
+            : type(the_type)
+            , rec(std::move(the_rec))
+        {
+        }
+
+        item_type type{item_type::log};
+        std::shared_ptr<const record> rec;
+    };
+
+    struct worker
+    {
+        static const size_t max_batch_size = 256;
+
+        worker(std::vector<sink_ptr> worker_sinks, async_overflow_policy policy, size_t queue_size, log_err_handler handler)
+            : sinks(std::move(worker_sinks))
+            , overflow_policy(policy)
+            , q(queue_size)
+            , err_handler(std::move(handler))
+        {
+            thread = std::thread([this] { loop_(); });
+        }
+
+        worker(const worker &) = delete;
+        worker &operator=(const worker &) = delete;
+
+        // released by the last list referring to it: nothing can be posted anymore
+        ~worker()
+        {
+            try
+            {
+                q.enqueue(item{item_type::terminate, nullptr});
+                thread.join();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        bool should_log(level::level_enum msg_level) const
+        {
+            return std::any_of(sinks.begin(), sinks.end(), [=](const sink_ptr &s) { return s->should_log(msg_level); });
+        }
+
+        void post(item &&new_item)
+        {
+            if (new_item.type != item_type::log)
+            {
+                q.enqueue(std::move(new_item));
+                return;
+            }
+            switch (overflow_policy)
+            {
+            case async_overflow_policy::block:
+                q.enqueue(std::move(new_item));
+                break;
+            case async_overflow_policy::overrun_oldest:
+                q.enqueue_nowait(std::move(new_item));
+                break;
+            case async_overflow_policy::discard_new:
+                if (!q.try_enqueue(std::move(new_item)))
+                {
+                    discarded.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            }
+        }
+
+        const std::vector<sink_ptr> sinks;
+        const async_overflow_policy overflow_policy;
+        details::mpmc_blocking_queue<item> q;
+        log_err_handler err_handler;
+        std::atomic<size_t> discarded{0}; // by discard_new
+        std::thread thread;
+
+    private:
+        void loop_()
+        {
+            std::vector<item> batch(max_batch_size);
+            std::vector<details::log_msg> msgs;
+            msgs.reserve(max_batch_size);
+            for (;;)
+            {
+                size_t count = q.dequeue_bulk_for(batch.data(), batch.size(), std::chrono::seconds(10));
+                bool terminate = false;
+                for (size_t i = 0; i < count; i++)
+                {
+                    auto &cur = batch[i];
+                    if (cur.type == item_type::log)
+                    {
+                        const record &r = *cur.rec;
+                        msgs.emplace_back(&r.logger_name, r.level, string_view_t(r.payload), r.time, r.thread_id);
+                        msgs.back().msg_id = r.msg_id;
+                        continue;
+                    }
+                    write_(msgs);
+                    if (cur.type == item_type::flush)
+                    {
+                        flush_();
+                    }
+                    else
+                    {
+                        terminate = true;
+                    }
+                }
+                write_(msgs);
+                // release the records now rather than when overwritten by the next batch
+                for (size_t i = 0; i < count; i++)
+                {
+                    batch[i].rec.reset();
+                }
+                if (terminate)
+                {
+                    flush_();
+                    return;
+                }
+            }
+        }
+
+        void write_(std::vector<details::log_msg> &msgs)
+        {
+            if (msgs.empty())
+            {
+                return;
+            }
+            for (auto &s : sinks)
+            {
+                try
+                {
+                    if (std::all_of(msgs.begin(), msgs.end(), [&](const details::log_msg &msg) { return s->should_log(msg.level); }))
+                    {
+                        s->log_batch(msgs.data(), msgs.size());
+                        continue;
+                    }
+                    for (auto &msg : msgs)
+                    {
+                        if (s->should_log(msg.level))
+                        {
+                            s->log(msg);
+                        }
+                    }
+                }
+                SPDLOG_CATCH_AND_HANDLE
+            }
+            msgs.clear();
+        }
+
+        void flush_()
+        {
+            for (auto &s : sinks)
+            {
+                try
+                {
+                    s->flush();
+                }
+                SPDLOG_CATCH_AND_HANDLE
+            }
+        }
+
+        void err_handler_(const std::string &msg)
+        {
+            if (err_handler)
+            {
+                err_handler(msg);
+            }
+        }
+    };
+
+    using workers_list = std::vector<std::shared_ptr<worker>>;
+
+    static void default_err_handler_(const std::string &msg)
+    {
+        static std::atomic<std::time_t> last_err_time{0};
+        auto now = std::time(nullptr);
+        auto last = last_err_time.load(std::memory_order_relaxed);
+        if (now - last < 60 || !last_err_time.compare_exchange_strong(last, now))
+        {
+            return;
+        }
+        auto tm_time = details::os::localtime(now);
+        char date_buf[100];
+        std::strftime(date_buf, sizeof(date_buf), "%Y-%m-%d %H:%M:%S", &tm_time);
+        fmt::print(stderr, "[*** LOG ERROR ***] [{}] [async_dist_sink] {}\n", date_buf, msg);
+    }
+
+    const size_t queue_size_;
+    std::mutex mutex_; // serializes the changes of the workers list
+    std::shared_ptr<const workers_list> workers_;
+    log_err_handler err_handler_;
+};
+
+} // namespace sinks
+} // namespace spdlog
@@ -7,6 +7,8 @@
 //
 // base sink templated over a mutex (either dummy or real)
 // concrete implementation should override the sink_it_() and flush_()  methods.
+// batches are passed to sink_batch_(), which calls sink_it_() for each message
+// unless overridden.
 // locking is taken care of in this class - no locking needed by the
 // implementers..
 //
@@ -32,6 +34,13 @@ public:
         sink_it_(msg);
     }
 
+    // take the mutex once for the whole batch
+    void log_batch(const details::log_msg *msgs, size_t count) final
+    {
+        std::lock_guard<Mutex> lock(mutex_);
+        sink_batch_(msgs, count);
+    }
+
     void flush() final
     {
         std::lock_guard<Mutex> lock(mutex_);
@@ -54,6 +63,15 @@ protected:
     virtual void sink_it_(const details::log_msg &msg) = 0;
     virtual void flush_() = 0;
 
+    // called with the mutex held. override to write the whole batch at once.
+    virtual void sink_batch_(const details::log_msg *msgs, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            sink_it_(msgs[i]);
+        }
+    }
+
     virtual void set_pattern_(const std::string &pattern)
     {
         set_formatter_(details::make_unique<spdlog::pattern_formatter>(pattern));
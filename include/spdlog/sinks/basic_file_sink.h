@@ -38,6 +38,17 @@ protected:
         file_helper_.write(formatted);
     }
 
+    // format the whole batch and write it at once
+    void sink_batch_(const details::log_msg *msgs, size_t count) override
+    {
+        fmt::memory_buffer formatted;
+        for (size_t i = 0; i < count; i++)
+        {
+            sink::formatter_->format(msgs[i], formatted);
+        }
+        file_helper_.write(formatted);
+    }
+
     void flush_() override
     {
         file_helper_.flush();
@@ -0,0 +1,95 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+#ifndef SPDLOG_H
+#error "spdlog.h must be included before this file."
+#endif
+
+#include "spdlog/details/binary_log.h"
+#include "spdlog/details/file_helper.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/sinks/base_sink.h"
+
+#include <mutex>
+#include <string>
+
+namespace spdlog {
+namespace sinks {
+/*
+ * Binary file sink (see details/binary_log.h for the format).
+ * Messages of async loggers using deferred formatting are stored as an interned format string
+ * and their encoded arguments, all the others as their formatted text.
+ * The pattern/formatter of the sink is not used: the layout is applied by the decoder tool
+ * (tools/binary_log_decoder.cpp).
+ */
+template<typename Mutex>
+class binary_file_sink final : public base_sink<Mutex>
+{
+public:
+    explicit binary_file_sink(const filename_t &filename, bool truncate = false)
+    {
+        file_helper_.open(filename, truncate);
+        fmt::memory_buffer header;
+        encoder_.begin(header);
+        file_helper_.write(header);
+    }
+
+    bool needs_deferred_text() const override
+    {
+        return false;
+    }
+
+protected:
+    void sink_it_(const details::log_msg &msg) override
+    {
+        fmt::memory_buffer encoded;
+        encoder_.encode(msg, encoded);
+        file_helper_.write(encoded);
+    }
+
+    // encode the whole batch and write it at once
+    void sink_batch_(const details::log_msg *msgs, size_t count) override
+    {
+        fmt::memory_buffer encoded;
+        for (size_t i = 0; i < count; i++)
+        {
+            encoder_.encode(msgs[i], encoded);
+        }
+        file_helper_.write(encoded);
+    }
+
+    void flush_() override
+    {
+        file_helper_.flush();
+    }
+
+private:
+    details::file_helper file_helper_;
+    details::binary_log::encoder encoder_;
+};
+
+using binary_file_sink_mt = binary_file_sink<std::mutex>;
+using binary_file_sink_st = binary_file_sink<details::null_mutex>;
+
+} // namespace sinks
+
+//
+// factory functions
+//
+template<typename Factory = default_factory>
+inline std::shared_ptr<logger> binary_logger_mt(const std::string &logger_name, const filename_t &filename, bool truncate = false)
+{
+    return Factory::template create<sinks::binary_file_sink_mt>(logger_name, filename, truncate);
+}
+
+template<typename Factory = default_factory>
+inline std::shared_ptr<logger> binary_logger_st(const std::string &logger_name, const filename_t &filename, bool truncate = false)
+{
+    return Factory::template create<sinks::binary_file_sink_st>(logger_name, filename, truncate);
+}
+
+} // namespace spdlog
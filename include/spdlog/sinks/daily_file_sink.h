@@ -10,6 +10,10 @@
 #endif
 
 #include "spdlog/details/file_helper.h"
+#ifdef SPDLOG_USE_ZLIB
+#include "spdlog/details/gzip_file.h"
+#include "spdlog/details/rotation_worker.h"
+#endif
 #include "spdlog/details/null_mutex.h"
 #include "spdlog/fmt/fmt.h"
 #include "spdlog/sinks/base_sink.h"
@@ -42,6 +46,7 @@ struct daily_filename_calculator
 
 /*
  * Rotating file sink based on date. rotates at midnight
+ * If SPDLOG_USE_ZLIB is defined, the previous file is gzipped by a background worker.
  */
 template<typename Mutex, typename FileNameCalc = daily_filename_calculator>
 class daily_file_sink final : public base_sink<Mutex>
@@ -69,12 +74,34 @@ protected:
 
         if (msg.time >= rotation_tp_)
         {
-            file_helper_.open(FileNameCalc::calc_filename(base_filename_, now_tm(msg.time)), truncate_);
-            rotation_tp_ = next_rotation_tp_();
+            rotate_(msg.time);
         }
         fmt::memory_buffer formatted;
         sink::formatter_->format(msg, formatted);
         file_helper_.write(formatted);
+#ifdef SPDLOG_USE_ZLIB
+        worker_.check_error();
+#endif
+    }
+
+    // format the whole batch and write it at once (or in parts if the file rotates in between)
+    void sink_batch_(const details::log_msg *msgs, size_t count) override
+    {
+        fmt::memory_buffer batch;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (msgs[i].time >= rotation_tp_)
+            {
+                file_helper_.write(batch);
+                batch.clear();
+                rotate_(msgs[i].time);
+            }
+            sink::formatter_->format(msgs[i], batch);
+        }
+        file_helper_.write(batch);
+#ifdef SPDLOG_USE_ZLIB
+        worker_.check_error();
+#endif
     }
 
     void flush_() override
@@ -83,6 +110,21 @@ protected:
     }
 
 private:
+    void rotate_(log_clock::time_point tp)
+    {
+#ifdef SPDLOG_USE_ZLIB
+        filename_t old_filename = file_helper_.filename();
+#endif
+        file_helper_.open(FileNameCalc::calc_filename(base_filename_, now_tm(tp)), truncate_);
+        rotation_tp_ = next_rotation_tp_();
+#ifdef SPDLOG_USE_ZLIB
+        if (old_filename != file_helper_.filename())
+        {
+            worker_.post([old_filename] { details::gzip_file(old_filename); });
+        }
+#endif
+    }
+
     tm now_tm(log_clock::time_point tp)
     {
         time_t tnow = log_clock::to_time_t(tp);
@@ -110,6 +152,9 @@ private:
     log_clock::time_point rotation_tp_;
     details::file_helper file_helper_;
     bool truncate_;
+#ifdef SPDLOG_USE_ZLIB
+    details::rotation_worker worker_;
+#endif
 };
 
 using daily_file_sink_mt = daily_file_sink<std::mutex>;
@@ -63,6 +63,26 @@ protected:
         }
     }
 
+    // pass the batch on to each sink
+    void sink_batch_(const details::log_msg *msgs, size_t count) override
+    {
+        for (auto &sink : sinks_)
+        {
+            if (std::all_of(msgs, msgs + count, [&](const details::log_msg &msg) { return sink->should_log(msg.level); }))
+            {
+                sink->log_batch(msgs, count);
+                continue;
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                if (sink->should_log(msgs[i].level))
+                {
+                    sink->log(msgs[i]);
+                }
+            }
+        }
+    }
+
     void flush_() override
     {
         for (auto &sink : sinks_)
@@ -0,0 +1,87 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+#ifndef SPDLOG_H
+#error "spdlog.h must be included before this file."
+#endif
+
+#include "spdlog/details/mmap_file.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/sinks/base_sink.h"
+
+#include <mutex>
+#include <string>
+
+namespace spdlog {
+namespace sinks {
+/*
+ * Memory mapped file sink: the formatted records are copied straight into the mapping of the
+ * file, which grows in preallocated extents (see details/mmap_file.h).
+ * flush() writes back the dirty pages according to the flush policy.
+ */
+template<typename Mutex>
+class mmap_file_sink final : public base_sink<Mutex>
+{
+public:
+    explicit mmap_file_sink(const filename_t &filename, bool truncate = false, mmap_flush_policy flush_policy = mmap_flush_policy::none,
+        size_t extent_size = details::mmap_file::default_extent_size)
+        : file_(flush_policy, extent_size)
+    {
+        file_.open(filename, truncate);
+    }
+
+protected:
+    void sink_it_(const details::log_msg &msg) override
+    {
+        fmt::memory_buffer formatted;
+        sink::formatter_->format(msg, formatted);
+        file_.write(formatted);
+    }
+
+    // format the whole batch and copy it at once
+    void sink_batch_(const details::log_msg *msgs, size_t count) override
+    {
+        fmt::memory_buffer formatted;
+        for (size_t i = 0; i < count; i++)
+        {
+            sink::formatter_->format(msgs[i], formatted);
+        }
+        file_.write(formatted);
+    }
+
+    void flush_() override
+    {
+        file_.flush();
+    }
+
+private:
+    details::mmap_file file_;
+};
+
+using mmap_file_sink_mt = mmap_file_sink<std::mutex>;
+using mmap_file_sink_st = mmap_file_sink<details::null_mutex>;
+
+} // namespace sinks
+
+//
+// factory functions
+//
+template<typename Factory = default_factory>
+inline std::shared_ptr<logger> mmap_logger_mt(const std::string &logger_name, const filename_t &filename, bool truncate = false,
+    mmap_flush_policy flush_policy = mmap_flush_policy::none)
+{
+    return Factory::template create<sinks::mmap_file_sink_mt>(logger_name, filename, truncate, flush_policy);
+}
+
+template<typename Factory = default_factory>
+inline std::shared_ptr<logger> mmap_logger_st(const std::string &logger_name, const filename_t &filename, bool truncate = false,
+    mmap_flush_policy flush_policy = mmap_flush_policy::none)
+{
+    return Factory::template create<sinks::mmap_file_sink_st>(logger_name, filename, truncate, flush_policy);
+}
+
+} // namespace spdlog
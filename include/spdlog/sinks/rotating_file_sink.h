@@ -10,22 +10,39 @@
 #endif
 
 #include "spdlog/details/file_helper.h"
+#ifdef SPDLOG_USE_ZLIB
+#include "spdlog/details/gzip_file.h"
+#endif
 #include "spdlog/details/null_mutex.h"
+#include "spdlog/details/rotation_worker.h"
 #include "spdlog/fmt/fmt.h"
 #include "spdlog/sinks/base_sink.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <ctime>
 #include <mutex>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace spdlog {
 namespace sinks {
 
 //
-// Rotating file sink based on size
+// Rotating file sink based on size.
+// The current file is always the base filename. On rotation it is renamed to the next index
+// (log.txt -> log.<n+1>.txt, so higher index = newer) and a new base file is opened. Only the
+// last max_files rotated files are kept. The older ones are deleted by a background worker, so
+// rotation costs a single rename on the logging path, whatever max_files is.
+// If SPDLOG_USE_ZLIB is defined the rotated files are gzipped by the background worker too.
+// On startup the index continues from the highest one found next to the base file.
+// Files rotated by the former layout (log.1.txt the newest, log.<max_files>.txt the oldest) are
+// renumbered on the first start: log.<i>.txt -> log.<2n+1-i>.txt, n their highest index. They are
+// told from the current layout by log.1.txt being newer than log.<n>.txt, so the migration is
+// skipped (and the lowest indices deleted first, as the oldest) if the files were all written
+// within the same second.
 //
 template<typename Mutex>
 class rotating_file_sink final : public base_sink<Mutex>
@@ -38,6 +55,7 @@ public:
     {
         file_helper_.open(calc_filename(base_filename_, 0));
         current_size_ = file_helper_.size(); // expensive. called only once
+        init_index_();
     }
 
     // calc filename according to index and file extension if exists.
@@ -70,6 +88,30 @@ protected:
             current_size_ = formatted.size();
         }
         file_helper_.write(formatted);
+        check_rotate_error_();
+    }
+
+    // format the whole batch and write it at once (or in parts if the file rotates in between)
+    void sink_batch_(const details::log_msg *msgs, size_t count) override
+    {
+        fmt::memory_buffer batch;
+        fmt::memory_buffer formatted;
+        for (size_t i = 0; i < count; i++)
+        {
+            formatted.clear();
+            sink::formatter_->format(msgs[i], formatted);
+            current_size_ += formatted.size();
+            if (current_size_ > max_size_)
+            {
+                file_helper_.write(batch);
+                batch.clear();
+                rotate_();
+                current_size_ = formatted.size();
+            }
+            details::fmt_helper::append_buf(formatted, batch);
+        }
+        file_helper_.write(batch);
+        check_rotate_error_();
     }
 
     void flush_() override
@@ -79,54 +121,227 @@ protected:
 
 private:
     // Rotate files:
-    // log.txt -> log.1.txt
-    // log.1.txt -> log.2.txt
-    // log.2.txt -> log.3.txt
-    // log.3.txt -> delete
+    // log.txt -> log.<index + 1>.txt (-> log.<index + 1>.txt.gz in the background if SPDLOG_USE_ZLIB is defined)
+    // log.<index + 1 - max_files>.txt -> delete (in the background)
+    //
+    // if the rename fails (e.g. on windows, because of antivirus), keep writing to the current file
+    // and try again after another max_size bytes. the error is thrown once the record is written.
     void rotate_()
     {
-        using details::os::filename_to_str;
         file_helper_.close();
-        for (auto i = max_files_; i > 0; --i)
+        if (max_files_ == 0)
+        {
+            file_helper_.reopen(true);
+            return;
+        }
+        filename_t src = calc_filename(base_filename_, 0);
+        filename_t target = calc_filename(base_filename_, index_ + 1);
+        if (details::os::rename(src, target) != 0)
+        {
+            auto err = errno;
+            auto msg = "rotating_file_sink: failed renaming " + details::os::filename_to_str(src) + " to " + details::os::filename_to_str(target);
+            rotate_error_ = spdlog_ex(msg, err).what();
+            file_helper_.reopen(false);
+            return;
+        }
+        ++index_;
+        file_helper_.reopen(true);
+#ifdef SPDLOG_USE_ZLIB
+        compress_files_({index_});
+#endif
+        if (index_ > max_files_)
+        {
+            remove_files_({index_ - max_files_});
+        }
+    }
+
+    // throw the error of the last rotation, or of the background work, if any
+    void check_rotate_error_()
+    {
+        if (!rotate_error_.empty())
+        {
+            std::string err;
+            err.swap(rotate_error_);
+            throw spdlog_ex(err);
+        }
+        worker_.check_error();
+    }
+
+    // find the highest index of the rotated files, and delete the ones beyond max_files
+    // (and compress the ones left uncompressed if SPDLOG_USE_ZLIB is defined)
+    void init_index_()
+    {
+        index_ = 0;
+        std::vector<std::size_t> indices;       // all the rotated files
+        std::vector<std::size_t> plain_indices; // the uncompressed ones
+        filename_t dir, basename, ext;
+        std::tie(basename, ext) = details::file_helper::split_by_extenstion(base_filename_);
+        auto folder_index = basename.rfind(details::os::folder_sep);
+        if (folder_index != filename_t::npos)
+        {
+            dir = basename.substr(0, folder_index);
+            basename = basename.substr(folder_index + 1);
+        }
+        else
+        {
+            dir = SPDLOG_FILENAME_T(".");
+        }
+        if (dir.empty())
+        {
+            dir.assign(1, details::os::folder_sep);
+        }
+        for (const auto &name : details::os::dir_files(dir))
         {
-            filename_t src = calc_filename(base_filename_, i - 1);
-            if (!details::file_helper::file_exists(src))
+            std::size_t index;
+            if (parse_index_(name, basename, ext, index))
+            {
+                plain_indices.push_back(index);
+            }
+#ifdef SPDLOG_USE_ZLIB
+            else if (!parse_index_(name, basename, ext + SPDLOG_FILENAME_T(".gz"), index))
+#else
+            else
+#endif
             {
                 continue;
             }
-            filename_t target = calc_filename(base_filename_, i);
+            indices.push_back(index);
+            index_ = std::max(index_, index);
+        }
+        // the former layout had no gzipped files
+        if (indices.size() > 1 && plain_indices.size() == indices.size() && renumber_former_layout_(indices))
+        {
+            plain_indices = indices;
+        }
 
-            if (!rename_file(src, target))
+        std::size_t oldest_kept = index_ > max_files_ ? index_ - max_files_ + 1 : 1;
+        std::vector<std::size_t> old_indices;
+        for (auto index : indices)
+        {
+            if (index < oldest_kept)
             {
-                // if failed try again after a small delay.
-                // this is a workaround to a windows issue, where very high rotation
-                // rates can cause the rename to fail with permission denied (because of antivirus?).
-                details::os::sleep_for_millis(100);
-                if (!rename_file(src, target))
-                {
-                    file_helper_.reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
-                    throw spdlog_ex(
-                        "rotating_file_sink: failed renaming " + filename_to_str(src) + " to " + filename_to_str(target), errno);
-                }
+                old_indices.push_back(index);
             }
         }
-        file_helper_.reopen(true);
+        if (!old_indices.empty())
+        {
+            remove_files_(old_indices);
+        }
+#ifdef SPDLOG_USE_ZLIB
+        std::vector<std::size_t> compress_indices;
+        for (auto index : plain_indices)
+        {
+            if (index >= oldest_kept)
+            {
+                compress_indices.push_back(index);
+            }
+        }
+        if (!compress_indices.empty())
+        {
+            compress_files_(compress_indices);
+        }
+#endif
     }
 
-    // delete the target if exists, and rename the src file  to target
-    // return true on success, false otherwise.
-    bool rename_file(const filename_t &src_filename, const filename_t &target_filename)
+    // if the rotated files are in the former layout (the lowest index the newest), rename each
+    // log.<i>.txt to log.<2n+1-i>.txt (n = index_), which reverses their order without a rename
+    // overwriting another file, and return true
+    bool renumber_former_layout_(std::vector<std::size_t> &indices)
     {
-        // try to delete the target file in case it already exists.
-        (void)details::os::remove(target_filename);
-        return details::os::rename(src_filename, target_filename) == 0;
+        auto lowest = *std::min_element(indices.begin(), indices.end());
+        if (details::os::file_mtime(calc_filename(base_filename_, lowest)) <= details::os::file_mtime(calc_filename(base_filename_, index_)))
+        {
+            return false;
+        }
+        std::size_t highest = index_;
+        for (auto &index : indices)
+        {
+            filename_t src = calc_filename(base_filename_, index);
+            filename_t target = calc_filename(base_filename_, 2 * highest + 1 - index);
+            if (details::os::rename(src, target) != 0)
+            {
+                throw spdlog_ex("rotating_file_sink: failed renaming " + details::os::filename_to_str(src) + " to " +
+                                    details::os::filename_to_str(target),
+                    errno);
+            }
+            index = 2 * highest + 1 - index;
+        }
+        index_ = 2 * highest + 1 - lowest;
+        return true;
     }
 
+    // match <basename>.<index><ext>
+    static bool parse_index_(const filename_t &name, const filename_t &basename, const filename_t &ext, std::size_t &index)
+    {
+        auto first = basename.size() + 1;
+        if (name.size() <= first + ext.size() || name.compare(0, basename.size(), basename) != 0 || name[basename.size()] != '.' ||
+            name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
+        {
+            return false;
+        }
+        auto last = name.size() - ext.size();
+        if (last - first > 18) // doesn't fit in 64 bits
+        {
+            return false;
+        }
+        index = 0;
+        for (auto i = first; i < last; ++i)
+        {
+            if (name[i] < '0' || name[i] > '9')
+            {
+                return false;
+            }
+            index = index * 10 + static_cast<std::size_t>(name[i] - '0');
+        }
+        return index != 0;
+    }
+
+    // delete the given rotated files (compressed or not) in the background
+    void remove_files_(std::vector<std::size_t> indices)
+    {
+        filename_t base_filename = base_filename_;
+        worker_.post([base_filename, indices] {
+            for (auto index : indices)
+            {
+                filename_t filename = calc_filename(base_filename, index);
+#ifdef SPDLOG_USE_ZLIB
+                remove_file_(details::gzip_filename(filename));
+#endif
+                remove_file_(filename);
+            }
+        });
+    }
+
+    static void remove_file_(const filename_t &filename)
+    {
+        if (details::os::remove(filename) != 0 && details::file_helper::file_exists(filename))
+        {
+            throw spdlog_ex("rotating_file_sink: failed removing " + details::os::filename_to_str(filename), errno);
+        }
+    }
+
+#ifdef SPDLOG_USE_ZLIB
+    // gzip the given rotated files in the background
+    void compress_files_(std::vector<std::size_t> indices)
+    {
+        filename_t base_filename = base_filename_;
+        worker_.post([base_filename, indices] {
+            for (auto index : indices)
+            {
+                details::gzip_file(calc_filename(base_filename, index));
+            }
+        });
+    }
+#endif
+
     filename_t base_filename_;
     std::size_t max_size_;
     std::size_t max_files_;
     std::size_t current_size_;
+    std::size_t index_; // index of the newest rotated file
+    std::string rotate_error_; // thrown after the record that triggered the rotation is written
     details::file_helper file_helper_;
+    details::rotation_worker worker_;
 };
 
 using rotating_file_sink_mt = rotating_file_sink<std::mutex>;
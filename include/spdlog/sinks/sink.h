@@ -28,6 +28,24 @@ public:
 
     virtual ~sink() = default;
     virtual void log(const details::log_msg &msg) = 0;
+
+    // log a batch of messages (e.g. from the async thread pool).
+    // override to write the whole batch at once.
+    virtual void log_batch(const details::log_msg *msgs, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            log(msgs[i]);
+        }
+    }
+
+    // false if the sink only needs the captured arguments of deferred formatting messages
+    // (they are then formatted only if another sink of the logger needs their text)
+    virtual bool needs_deferred_text() const
+    {
+        return true;
+    }
+
     virtual void flush() = 0;
     virtual void set_pattern(const std::string &pattern) = 0;
     virtual void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) = 0;
@@ -44,6 +44,19 @@ public:
         fflush(TargetStream::stream());
     }
 
+    // the whole batch in one write
+    void log_batch(const details::log_msg *msgs, size_t count) override
+    {
+        std::lock_guard<mutex_t> lock(mutex_);
+        fmt::memory_buffer formatted;
+        for (size_t i = 0; i < count; i++)
+        {
+            formatter_->format(msgs[i], formatted);
+        }
+        fwrite(formatted.data(), sizeof(char), formatted.size(), file_);
+        fflush(TargetStream::stream());
+    }
+
     void flush() override
     {
         std::lock_guard<mutex_t> lock(mutex_);
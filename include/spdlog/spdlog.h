@@ -10,6 +10,7 @@
 #pragma once
 
 #include "spdlog/common.h"
+#include "spdlog/details/log_limiter.h"
 #include "spdlog/details/registry.h"
 #include "spdlog/logger.h"
 #include "spdlog/version.h"
@@ -316,5 +317,31 @@ inline void critical(const wchar_t *fmt, const Args &... args)
 #define SPDLOG_DEBUG(logger, ...) (void)0
 #endif
 
+//
+// Per call site rate limiting and sampling (see details/log_limiter.h).
+// The limiter of the call site is checked (after the level) before formatting anything, so the
+// suppressed calls cost an atomic or two.
+//
+// Example:
+// // at most 10 messages/sec, in bursts of up to 100
+// SPDLOG_LOGGER_RATE_LIMITED(my_logger, spdlog::level::err, 10, 100, "read failed: {}", err);
+// // 1 of every 1000 messages
+// SPDLOG_LOGGER_SAMPLED(my_logger, spdlog::level::debug, 1000, "packet {} received", id);
+//
+
+#define SPDLOG_LOGGER_RATE_LIMITED(logger, lvl, rate_per_sec, burst, ...)                                                                  \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        static spdlog::details::rate_limiter spdlog_rate_limiter_(rate_per_sec, burst);                                                    \
+        (logger)->log_limited(spdlog_rate_limiter_, lvl, __VA_ARGS__);                                                                     \
+    } while (0)
+
+#define SPDLOG_LOGGER_SAMPLED(logger, lvl, n, ...)                                                                                         \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        static spdlog::details::log_sampler spdlog_log_sampler_(n);                                                                        \
+        (logger)->log_limited(spdlog_log_sampler_, lvl, __VA_ARGS__);                                                                      \
+    } while (0)
+
 } // namespace spdlog
 #endif // SPDLOG_H
@@ -21,6 +21,16 @@
 // #define SPDLOG_CLOCK_COARSE
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// The clock can also be chosen per logger, with logger::set_clock(..):
+// system (default), coarse, cached (the time stored by a ticker thread) or tsc
+// (cpu ticks, converted to the time by the async backend).
+// Uncomment and set to change the period of the ticker thread of the cached
+// clock. The message times are stale by up to this period.
+//
+// #define SPDLOG_CACHED_CLOCK_INTERVAL_MS 1
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment if date/time logging is not needed and never appear in the log
 // pattern.
@@ -115,6 +125,49 @@
 // #define SPDLOG_ENABLE_MESSAGE_COUNTER
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to use a lock-free bounded queue in the async thread pool instead
+// of the mutex based one.
+// Producers never lock. The backend threads only park when the queue is empty.
+// Note: the queue capacity is rounded up to the next power of two.
+//
+// #define SPDLOG_LOCKFREE_QUEUE
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to give each producer thread its own queue in the async thread
+// pool. The backend threads merge the queues by message time, so the order of
+// each thread is kept and producers do not share any cache line.
+// The queue size passed to the thread pool becomes the max size of each
+// thread's queue: they start small and grow under bursts, in buffers the
+// backend allocates ahead of time (the producers don't allocate).
+// Queues of exited threads are reclaimed once drained, and the queues of idle
+// threads shrink back after a minute.
+// Overrides SPDLOG_LOCKFREE_QUEUE.
+//
+// #define SPDLOG_PER_THREAD_QUEUE
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to write the files of the file sinks (basic, rotating, daily) from a
+// background I/O thread per file (POSIX only).
+// The records are double buffered: while a buffer is written, the next one is
+// filled, so a stalled disk doesn't block the logging (or the async backend)
+// thread until 1MB are pending.
+//
+// #define SPDLOG_BACKGROUND_FILE_WRITER
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to gzip the rotated files of the rotating and daily file sinks
+// (log.1.txt -> log.1.txt.gz). Requires linking with zlib.
+// The files are compressed by a background thread per sink, which is limited to
+// SPDLOG_ZLIB_CPU_PERCENT percent of a core (it sleeps between chunks).
+//
+// #define SPDLOG_USE_ZLIB
+// #define SPDLOG_ZLIB_CPU_PERCENT 25
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment to customize level names (e.g. "MT TRACE")
 //
@@ -0,0 +1,265 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// ns per call of the fmt_helper digit kernels (pad2, pad3, pad6, pad9, append_int, append_hms)
+// and ns per record of a "HH:MM:SS.mmm [thread id] " timestamp, in the Google Benchmark output
+// layout. each BM_x/old line is the kernel before the digit tables (one push_back per digit,
+// fmt::format_int / format_to above), kept here for comparison.
+// the old and new kernels are checked to write the same text.
+//
+// usage: bench_fmt_helper [iterations]
+// (default 20000000)
+//
+// build: c++ -std=c++11 -O2 -I../include bench_fmt_helper.cpp -o bench_fmt_helper -pthread
+
+#include "spdlog/spdlog.h"
+#include "spdlog/details/fmt_helper.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// the former kernels
+namespace old_kernels {
+inline void append_int(long long n, fmt::memory_buffer &dest)
+{
+    fmt::format_int i(n);
+    dest.append(i.data(), i.data() + i.size());
+}
+
+inline void pad2(int n, fmt::memory_buffer &dest)
+{
+    if (n > 99)
+    {
+        append_int(n, dest);
+        return;
+    }
+    if (n > 9)
+    {
+        dest.push_back(static_cast<char>('0' + n / 10));
+        dest.push_back(static_cast<char>('0' + n % 10));
+        return;
+    }
+    if (n >= 0)
+    {
+        dest.push_back('0');
+        dest.push_back(static_cast<char>('0' + n));
+        return;
+    }
+    fmt::format_to(dest, "{:02}", n);
+}
+
+inline void pad3(int n, fmt::memory_buffer &dest)
+{
+    if (n > 999)
+    {
+        append_int(n, dest);
+        return;
+    }
+    if (n > 99)
+    {
+        dest.push_back(static_cast<char>('0' + n / 100));
+        pad2(n % 100, dest);
+        return;
+    }
+    if (n > 9)
+    {
+        dest.push_back('0');
+        dest.push_back(static_cast<char>('0' + n / 10));
+        dest.push_back(static_cast<char>('0' + n % 10));
+        return;
+    }
+    if (n >= 0)
+    {
+        dest.push_back('0');
+        dest.push_back('0');
+        dest.push_back(static_cast<char>('0' + n));
+        return;
+    }
+    fmt::format_to(dest, "{:03}", n);
+}
+
+inline void pad6(size_t n, fmt::memory_buffer &dest)
+{
+    if (n > 99999)
+    {
+        append_int(static_cast<long long>(n), dest);
+        return;
+    }
+    pad3(static_cast<int>(n / 1000), dest);
+    pad3(static_cast<int>(n % 1000), dest);
+}
+
+// %F
+inline void pad9(size_t n, fmt::memory_buffer &dest)
+{
+    fmt::format_to(dest, "{:09}", n);
+}
+
+// %T
+inline void append_hms(int h, int m, int s, fmt::memory_buffer &dest)
+{
+    pad2(h, dest);
+    dest.push_back(':');
+    pad2(m, dest);
+    dest.push_back(':');
+    pad2(s, dest);
+}
+} // namespace old_kernels
+
+namespace new_kernels {
+namespace fmt_helper = spdlog::details::fmt_helper;
+
+inline void append_int(long long n, fmt::memory_buffer &dest)
+{
+    fmt_helper::append_int(n, dest);
+}
+inline void pad2(int n, fmt::memory_buffer &dest)
+{
+    fmt_helper::pad2(n, dest);
+}
+inline void pad3(int n, fmt::memory_buffer &dest)
+{
+    fmt_helper::pad3(n, dest);
+}
+inline void pad6(size_t n, fmt::memory_buffer &dest)
+{
+    fmt_helper::pad6(n, dest);
+}
+inline void pad9(size_t n, fmt::memory_buffer &dest)
+{
+    fmt_helper::pad9(n, dest);
+}
+inline void append_hms(int h, int m, int s, fmt::memory_buffer &dest)
+{
+    fmt_helper::append_hms(h, m, s, dest);
+}
+} // namespace new_kernels
+
+// the kernels of a record: "HH:MM:SS.mmm [thread id] "
+struct old_record
+{
+    static void format(size_t i, fmt::memory_buffer &dest)
+    {
+        unsigned secs = static_cast<unsigned>(i / 1000);
+        old_kernels::append_hms(static_cast<int>(secs / 3600 % 24), static_cast<int>(secs / 60 % 60), static_cast<int>(secs % 60), dest);
+        dest.push_back('.');
+        old_kernels::pad3(static_cast<int>(i % 1000), dest);
+        dest.push_back(' ');
+        dest.push_back('[');
+        old_kernels::pad6(12345 + i % 64, dest);
+        dest.push_back(']');
+        dest.push_back(' ');
+    }
+};
+
+struct new_record
+{
+    static void format(size_t i, fmt::memory_buffer &dest)
+    {
+        unsigned secs = static_cast<unsigned>(i / 1000);
+        new_kernels::append_hms(static_cast<int>(secs / 3600 % 24), static_cast<int>(secs / 60 % 60), static_cast<int>(secs % 60), dest);
+        dest.push_back('.');
+        new_kernels::pad3(static_cast<int>(i % 1000), dest);
+        dest.push_back(' ');
+        dest.push_back('[');
+        new_kernels::pad6(12345 + i % 64, dest);
+        dest.push_back(']');
+        dest.push_back(' ');
+    }
+};
+
+static volatile size_t keep = 0;
+
+// ns per call of kernel(i, dest)
+template<typename Kernel>
+static double bench(size_t iterations, Kernel kernel)
+{
+    fmt::memory_buffer dest;
+    size_t written = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        dest.resize(0);
+        kernel(i, dest);
+        written += dest.size() + static_cast<unsigned char>(dest.data()[0]);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    keep = keep + written;
+    return elapsed.count() / iterations;
+}
+
+static void report(const char *name, size_t iterations, double ns)
+{
+    std::printf("%-26s %10.1f ns %14zu\n", name, ns, iterations);
+}
+
+template<typename Old, typename New>
+static size_t check(size_t count, Old old_kernel, New new_kernel)
+{
+    fmt::memory_buffer a, b;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        a.resize(0);
+        b.resize(0);
+        old_kernel(i, a);
+        new_kernel(i, b);
+        if (a.size() != b.size() || std::memcmp(a.data(), b.data(), a.size()) != 0)
+        {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+#define BENCH_PAIR_(name, count, call)                                                                                                     \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        auto old_kernel = [](size_t i, fmt::memory_buffer &dest) {                                                                         \
+            using namespace old_kernels;                                                                                                   \
+            call;                                                                                                                          \
+        };                                                                                                                                 \
+        auto new_kernel = [](size_t i, fmt::memory_buffer &dest) {                                                                         \
+            using namespace new_kernels;                                                                                                   \
+            call;                                                                                                                          \
+        };                                                                                                                                 \
+        report(name "/old", iterations, bench(iterations, old_kernel));                                                                   \
+        report(name, iterations, bench(iterations, new_kernel));                                                                          \
+        mismatches += check(count, old_kernel, new_kernel);                                                                                \
+    } while (0)
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000000;
+    if (iterations == 0)
+    {
+        std::fprintf(stderr, "usage: bench_fmt_helper [iterations]\n");
+        return 1;
+    }
+
+    std::printf("%-26s %13s %14s\n", "Benchmark", "Time", "Iterations");
+    std::printf("-------------------------------------------------------\n");
+    size_t mismatches = 0;
+    BENCH_PAIR_("BM_pad2", 2000000, pad2(static_cast<int>(i % 60), dest));
+    BENCH_PAIR_("BM_pad3", 2000000, pad3(static_cast<int>(i % 1000), dest));
+    BENCH_PAIR_("BM_pad6", 2000000, pad6(i % 1000000, dest));
+    BENCH_PAIR_("BM_pad9", 2000000, pad9(i * 7919 % 1000000000, dest));
+    BENCH_PAIR_("BM_append_int/year", 2000000, append_int(static_cast<long long>(1970 + i % 130), dest));
+    BENCH_PAIR_("BM_append_int/pid", 2000000, append_int(static_cast<long long>(i % 4194304), dest));
+    BENCH_PAIR_("BM_append_hms", 2000000,
+        append_hms(static_cast<int>(i / 3600 % 24), static_cast<int>(i / 60 % 60), static_cast<int>(i % 60), dest));
+    report("BM_record/old", iterations, bench(iterations, old_record::format));
+    report("BM_record", iterations, bench(iterations, new_record::format));
+    mismatches += check(2000000, old_record::format, new_record::format);
+
+    if (mismatches != 0)
+    {
+        std::fprintf(stderr, "bench_fmt_helper: %zu values written differently by the old and new kernels\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
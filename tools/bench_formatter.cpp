@@ -0,0 +1,282 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// ns per record of the pattern formatters: the flat opcode pattern_formatter, the compile-time
+// SPDLOG_STATIC_PATTERN formatters, and the "virtual" column, the formatter before the opcodes (a
+// vector of heap allocated flag formatters with one virtual call each), for comparison. all of
+// them use the same fmt_helper kernels, so the difference is the dispatch.
+//
+// usage: bench_formatter [records]
+// (default 5000000, one microsecond apart)
+//
+// build: c++ -std=c++11 -O2 -I../include bench_formatter.cpp -o bench_formatter -pthread
+
+#include "spdlog/spdlog.h"
+#include "spdlog/details/pattern_formatter.h"
+#include "spdlog/details/static_pattern_formatter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the former pattern_formatter, with the flags of the benchmarked patterns
+namespace virtual_pattern {
+using spdlog::details::log_msg;
+namespace fmt_helper = spdlog::details::fmt_helper;
+
+class flag_formatter
+{
+public:
+    virtual ~flag_formatter() = default;
+    virtual void format(const log_msg &msg, const std::tm &tm_time, fmt::memory_buffer &dest) = 0;
+};
+
+class name_formatter final : public flag_formatter
+{
+    void format(const log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::append_string_view(spdlog::string_view_t(*msg.logger_name), dest);
+    }
+};
+
+class level_formatter final : public flag_formatter
+{
+    void format(const log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::append_string_view(spdlog::level::to_c_str(msg.level), dest);
+    }
+};
+
+class Y_formatter final : public flag_formatter
+{
+    void format(const log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::append_int(tm_time.tm_year + 1900, dest);
+    }
+};
+
+// the two digit fields of the tm (month, day, hour, minute, second)
+class tm_field_formatter final : public flag_formatter
+{
+public:
+    tm_field_formatter(int std::tm::*field, int offset)
+        : field_(field)
+        , offset_(offset)
+    {
+    }
+    void format(const log_msg &, const std::tm &tm_time, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::pad2(tm_time.*field_ + offset_, dest);
+    }
+
+private:
+    int std::tm::*field_;
+    int offset_;
+};
+
+class e_formatter final : public flag_formatter
+{
+    void format(const log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    {
+        auto millis = fmt_helper::time_fraction<std::chrono::milliseconds>(msg.time);
+        fmt_helper::pad3(static_cast<int>(millis.count()), dest);
+    }
+};
+
+class t_formatter final : public flag_formatter
+{
+    void format(const log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::pad6(msg.thread_id, dest);
+    }
+};
+
+class v_formatter final : public flag_formatter
+{
+    void format(const log_msg &msg, const std::tm &, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::append_string_view(msg.payload, dest);
+    }
+};
+
+class aggregate_formatter final : public flag_formatter
+{
+public:
+    void add_ch(char ch)
+    {
+        str_ += ch;
+    }
+    void format(const log_msg &, const std::tm &, fmt::memory_buffer &dest) override
+    {
+        fmt_helper::append_string_view(str_, dest);
+    }
+
+private:
+    std::string str_;
+};
+
+class pattern_formatter final : public spdlog::formatter
+{
+public:
+    explicit pattern_formatter(const std::string &pattern)
+        : pattern_(pattern)
+    {
+        std::memset(&cached_tm_, 0, sizeof(cached_tm_));
+        std::unique_ptr<aggregate_formatter> user_chars;
+        for (auto it = pattern.begin(); it != pattern.end(); ++it)
+        {
+            if (*it == '%' && it + 1 != pattern.end())
+            {
+                if (user_chars)
+                {
+                    formatters_.push_back(std::move(user_chars));
+                }
+                formatters_.push_back(flag_(*++it));
+            }
+            else
+            {
+                if (!user_chars)
+                {
+                    user_chars.reset(new aggregate_formatter());
+                }
+                user_chars->add_ch(*it);
+            }
+        }
+        if (user_chars)
+        {
+            formatters_.push_back(std::move(user_chars));
+        }
+    }
+
+    std::unique_ptr<spdlog::formatter> clone() const override
+    {
+        return spdlog::details::make_unique<pattern_formatter>(pattern_);
+    }
+
+    void format(const log_msg &msg, fmt::memory_buffer &dest) override
+    {
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(msg.time.time_since_epoch());
+        if (secs != last_log_secs_)
+        {
+            cached_tm_ = spdlog::details::os::localtime(spdlog::log_clock::to_time_t(msg.time));
+            last_log_secs_ = secs;
+        }
+        for (auto &f : formatters_)
+        {
+            f->format(msg, cached_tm_, dest);
+        }
+        fmt_helper::append_string_view(spdlog::details::os::default_eol, dest);
+    }
+
+private:
+    std::string pattern_;
+    std::tm cached_tm_;
+    std::chrono::seconds last_log_secs_{0};
+    std::vector<std::unique_ptr<flag_formatter>> formatters_;
+
+    static std::unique_ptr<flag_formatter> flag_(char flag)
+    {
+        switch (flag)
+        {
+        case 'n':
+            return std::unique_ptr<flag_formatter>(new name_formatter());
+        case 'l':
+            return std::unique_ptr<flag_formatter>(new level_formatter());
+        case 'Y':
+            return std::unique_ptr<flag_formatter>(new Y_formatter());
+        case 'm':
+            return std::unique_ptr<flag_formatter>(new tm_field_formatter(&std::tm::tm_mon, 1));
+        case 'd':
+            return std::unique_ptr<flag_formatter>(new tm_field_formatter(&std::tm::tm_mday, 0));
+        case 'H':
+            return std::unique_ptr<flag_formatter>(new tm_field_formatter(&std::tm::tm_hour, 0));
+        case 'M':
+            return std::unique_ptr<flag_formatter>(new tm_field_formatter(&std::tm::tm_min, 0));
+        case 'S':
+            return std::unique_ptr<flag_formatter>(new tm_field_formatter(&std::tm::tm_sec, 0));
+        case 'e':
+            return std::unique_ptr<flag_formatter>(new e_formatter());
+        case 't':
+            return std::unique_ptr<flag_formatter>(new t_formatter());
+        case 'v':
+            return std::unique_ptr<flag_formatter>(new v_formatter());
+        default:
+            std::fprintf(stderr, "bench_formatter: flag %%%c not in the virtual formatter\n", flag);
+            std::exit(1);
+        }
+    }
+};
+} // namespace virtual_pattern
+
+// ns per record. the records are a microsecond apart, so the time is converted once a second of
+// records, as when logging a million messages a second. the formatters are called through the
+// formatter interface, as by the sinks
+static double run(spdlog::formatter &formatter, size_t records, std::string &last)
+{
+    std::string name = "bench";
+    const char *text = "some message text of a typical length, 42 chars";
+    spdlog::details::log_msg msg(&name, spdlog::level::info, text);
+    // the same records for each formatter
+    auto start_time = spdlog::log_clock::time_point(std::chrono::seconds(1500000000));
+    fmt::memory_buffer dest;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records; i++)
+    {
+        msg.time = start_time + std::chrono::microseconds(i);
+        dest.resize(0);
+        formatter.format(msg, dest);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    last.assign(dest.data(), dest.size());
+    return elapsed.count() / records;
+}
+
+struct bench_pattern
+{
+    const char *pattern;
+    std::unique_ptr<spdlog::formatter> static_formatter;
+};
+
+int main(int argc, char *argv[])
+{
+    size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000000;
+    if (records == 0)
+    {
+        std::fprintf(stderr, "usage: bench_formatter [records]\n");
+        return 1;
+    }
+
+    // the static patterns must be literals
+    bench_pattern patterns[] = {
+        {"[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v", spdlog::details::make_unique<SPDLOG_STATIC_PATTERN("[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v")>()},
+        {"[%H:%M:%S.%e] [%l] %v", spdlog::details::make_unique<SPDLOG_STATIC_PATTERN("[%H:%M:%S.%e] [%l] %v")>()},
+        {"%H:%M:%S.%e %t %v", spdlog::details::make_unique<SPDLOG_STATIC_PATTERN("%H:%M:%S.%e %t %v")>()},
+        {"%v", spdlog::details::make_unique<SPDLOG_STATIC_PATTERN("%v")>()},
+    };
+
+    std::printf("%zu records (ns per record)\n\n", records);
+    std::printf("%-38s | %8s %8s %8s\n", "pattern", "virtual", "opcodes", "static");
+    int status = 0;
+    for (auto &p : patterns)
+    {
+        virtual_pattern::pattern_formatter virtual_formatter(p.pattern);
+        spdlog::pattern_formatter opcode_formatter(p.pattern);
+        std::string virtual_out, opcode_out, static_out;
+        double virtual_ns = run(virtual_formatter, records, virtual_out);
+        double opcode_ns = run(opcode_formatter, records, opcode_out);
+        double static_ns = run(*p.static_formatter, records, static_out);
+        std::printf("%-38s | %8.1f %8.1f %8.1f\n", p.pattern, virtual_ns, opcode_ns, static_ns);
+        if (opcode_out != virtual_out || static_out != virtual_out)
+        {
+            std::fprintf(stderr, "bench_formatter: the formatters disagree on \"%s\"\n", p.pattern);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,130 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// ns per record of the epoch -> std::tm conversions of the formatters: details::time_converter
+// (cached offset and arithmetic) against os::localtime / os::gmtime (localtime_r / gmtime_r,
+// what the formatters called before), with 1 to 8 threads converting at once.
+// the records are 1 second apart (a new second for each record, the formatters' worst case) or
+// 1 hour apart (a new day every 24 records, so the converter refreshes its cache often).
+// the converted times are checked against os::localtime / os::gmtime.
+//
+// usage: bench_localtime [records_per_thread]
+// (default 1000000)
+//
+// build: c++ -std=c++11 -O2 -I../include bench_localtime.cpp -o bench_localtime -pthread
+
+#include "spdlog/spdlog.h"
+#include "spdlog/details/time_converter.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+static bool same_tm(const std::tm &a, const std::tm &b)
+{
+    return a.tm_year == b.tm_year && a.tm_mon == b.tm_mon && a.tm_mday == b.tm_mday && a.tm_hour == b.tm_hour && a.tm_min == b.tm_min &&
+           a.tm_sec == b.tm_sec && a.tm_wday == b.tm_wday && a.tm_yday == b.tm_yday && a.tm_isdst == b.tm_isdst;
+}
+
+// ns per conversion (mean of the threads). the threads convert the same times
+template<typename Convert>
+static double run(size_t threads, size_t records, std::time_t start_time, std::time_t step, Convert convert)
+{
+    std::atomic<bool> go{false};
+    std::atomic<int> sink{0};
+    std::vector<double> ns(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            int fields = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < records; i++)
+            {
+                std::tm tm = convert(start_time + static_cast<std::time_t>(i) * step);
+                fields += tm.tm_sec;
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            ns[t] = elapsed.count() / records;
+            sink.fetch_add(fields);
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    double mean = 0;
+    for (auto n : ns)
+    {
+        mean += n / threads;
+    }
+    return mean;
+}
+
+static size_t check(size_t records, std::time_t start_time, std::time_t step)
+{
+    auto &converter = spdlog::details::time_converter::instance();
+    size_t mismatches = 0;
+    for (size_t i = 0; i < records; i++)
+    {
+        std::time_t t = start_time + static_cast<std::time_t>(i) * step;
+        if (!same_tm(converter.localtime(t), spdlog::details::os::localtime(t)) ||
+            !same_tm(spdlog::details::time_converter::gmtime(t), spdlog::details::os::gmtime(t)))
+        {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    if (records == 0)
+    {
+        std::fprintf(stderr, "usage: bench_localtime [records_per_thread]\n");
+        return 1;
+    }
+
+    auto &converter = spdlog::details::time_converter::instance();
+    auto os_localtime = [](std::time_t t) { return spdlog::details::os::localtime(t); };
+    auto os_gmtime = [](std::time_t t) { return spdlog::details::os::gmtime(t); };
+    auto cached_localtime = [&converter](std::time_t t) { return converter.localtime(t); };
+    auto cached_gmtime = [](std::time_t t) { return spdlog::details::time_converter::gmtime(t); };
+
+    std::time_t now = std::time(nullptr);
+    std::printf("%zu records per thread, %u hardware threads (ns per record)\n\n", records, std::thread::hardware_concurrency());
+    std::printf("%5s %7s | %11s %11s | %11s %11s\n", "step", "threads", "localtime_r", "converter", "gmtime_r", "converter");
+    const std::time_t steps[] = {1, 3600};
+    for (auto step : steps)
+    {
+        for (size_t threads = 1; threads <= 8; threads *= 2)
+        {
+            double os_local_ns = run(threads, records, now, step, os_localtime);
+            double local_ns = run(threads, records, now, step, cached_localtime);
+            double os_gm_ns = run(threads, records, now, step, os_gmtime);
+            double gm_ns = run(threads, records, now, step, cached_gmtime);
+            std::printf("%4lds %7zu | %11.1f %11.1f | %11.1f %11.1f\n", static_cast<long>(step), threads, os_local_ns, local_ns, os_gm_ns,
+                gm_ns);
+        }
+    }
+
+    size_t mismatches = check(records, now, 1) + check(records, now, 3600);
+    if (mismatches != 0)
+    {
+        std::fprintf(stderr, "bench_localtime: %zu conversions differ from os::localtime / os::gmtime\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// contention benchmark of the thread pool queues: mpmc_lockfree_queue (SPDLOG_LOCKFREE_QUEUE) vs
+// mpmc_blocking_queue, with 1 to 64 producers and one consumer draining in bulk (as the thread
+// pool workers do).
+//
+// usage: bench_queue [total_messages] [queue_size]
+// (default 2000000 messages, split among the producers, and a queue of 8192 as the thread pool)
+//
+// build: c++ -std=c++11 -O2 -I../include bench_queue.cpp -o bench_queue -pthread
+
+#include "spdlog/common.h"
+#include "spdlog/details/mpmc_blocking_q.h"
+#include "spdlog/details/mpmc_lockfree_q.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// about the size of the small messages of the thread pool
+struct bench_item
+{
+    size_t producer = 0;
+    size_t seq = 0;
+    char payload[48] = {};
+};
+
+struct bench_result
+{
+    double seconds;
+    double enqueue_ns; // mean time of an enqueue, as seen by a producer
+    bool ordered;      // each producer's items were dequeued in order
+};
+
+template<typename Q>
+static bench_result run(size_t producers, size_t total, size_t queue_size)
+{
+    Q q(queue_size);
+    size_t per_producer = total / producers;
+    std::atomic<bool> go{false};
+    std::vector<double> enqueue_ns(producers);
+    bool ordered = true;
+
+    std::thread consumer([&] {
+        std::vector<size_t> next(producers, 0);
+        std::vector<bench_item> batch(256);
+        size_t received = 0;
+        while (received < per_producer * producers)
+        {
+            size_t n = q.dequeue_bulk_for(batch.data(), batch.size(), std::chrono::milliseconds(100));
+            for (size_t i = 0; i < n; i++)
+            {
+                ordered = ordered && batch[i].seq == next[batch[i].producer]++;
+            }
+            received += n;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < per_producer; i++)
+            {
+                bench_item item;
+                item.producer = p;
+                item.seq = i;
+                q.enqueue(std::move(item));
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            enqueue_ns[p] = elapsed.count() / per_producer;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    consumer.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double mean_ns = 0;
+    for (auto ns : enqueue_ns)
+    {
+        mean_ns += ns / producers;
+    }
+    return bench_result{elapsed.count(), mean_ns, ordered};
+}
+
+int main(int argc, char *argv[])
+{
+    size_t total = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    size_t queue_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8192;
+    if (total == 0 || queue_size == 0)
+    {
+        std::fprintf(stderr, "usage: bench_queue [total_messages] [queue_size]\n");
+        return 1;
+    }
+
+    std::printf("%zu messages, queue of %zu, %u hardware threads\n\n", total, queue_size, std::thread::hardware_concurrency());
+    std::printf("%9s | %14s %12s | %14s %12s | %7s\n", "producers", "lockfree msg/s", "enqueue ns", "blocking msg/s", "enqueue ns",
+        "speedup");
+
+    int status = 0;
+    for (size_t producers = 1; producers <= 64; producers *= 2)
+    {
+        size_t messages = total / producers * producers;
+        auto lockfree = run<spdlog::details::mpmc_lockfree_queue<bench_item>>(producers, total, queue_size);
+        auto blocking = run<spdlog::details::mpmc_blocking_queue<bench_item>>(producers, total, queue_size);
+        std::printf("%9zu | %14.0f %12.1f | %14.0f %12.1f | %6.2fx\n", producers, messages / lockfree.seconds, lockfree.enqueue_ns,
+            messages / blocking.seconds, blocking.enqueue_ns, blocking.seconds / lockfree.seconds);
+        if (!lockfree.ordered || !blocking.ordered)
+        {
+            std::fprintf(stderr, "bench_queue: items of a producer dequeued out of order (%s queue)\n", lockfree.ordered ? "blocking" : "lockfree");
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,130 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// multi-threaded benchmark of the registry lookups: spdlog::get and spdlog::default_logger, with 1
+// to 16 threads looking up 100 registered loggers. the "locked" column is the lookup the registry
+// did before the snapshots (a mutex and an unordered_map of shared_ptr), for comparison.
+//
+// usage: bench_registry_get [lookups_per_thread]
+// (default 1000000)
+//
+// build: c++ -std=c++11 -O2 -I../include bench_registry_get.cpp -o bench_registry_get -pthread
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const size_t logger_count = 100;
+
+// the former registry lookup
+class locked_registry
+{
+public:
+    void add(std::shared_ptr<spdlog::logger> l)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loggers_[l->name()] = std::move(l);
+    }
+
+    std::shared_ptr<spdlog::logger> get(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = loggers_.find(name);
+        return found == loggers_.end() ? nullptr : found->second;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<spdlog::logger>> loggers_;
+};
+
+// ns per lookup (mean of the threads). the lookups of a thread go round the names
+template<typename Lookup>
+static double run(size_t threads, size_t lookups, const std::vector<std::string> &names, Lookup lookup)
+{
+    std::atomic<bool> go{false};
+    std::atomic<size_t> misses{0};
+    std::vector<double> ns(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            size_t missed = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < lookups; i++)
+            {
+                if (!lookup(names[(i + t) % names.size()]))
+                {
+                    missed++;
+                }
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            ns[t] = elapsed.count() / lookups;
+            misses.fetch_add(missed);
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+    if (misses.load() != 0)
+    {
+        std::fprintf(stderr, "bench_registry_get: %zu lookups failed\n", misses.load());
+        std::exit(1);
+    }
+    double mean = 0;
+    for (auto n : ns)
+    {
+        mean += n / threads;
+    }
+    return mean;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t lookups = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    if (lookups == 0)
+    {
+        std::fprintf(stderr, "usage: bench_registry_get [lookups_per_thread]\n");
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    locked_registry locked;
+    for (size_t i = 0; i < logger_count; i++)
+    {
+        names.push_back("logger_" + std::to_string(i));
+        auto l = spdlog::create<spdlog::sinks::null_sink_mt>(names.back());
+        locked.add(l);
+    }
+
+    std::printf("%zu loggers, %zu lookups per thread, %u hardware threads (ns per lookup)\n\n", logger_count, lookups,
+        std::thread::hardware_concurrency());
+    std::printf("%7s | %10s %10s | %14s\n", "threads", "get", "locked", "default_logger");
+    for (size_t threads = 1; threads <= 16; threads *= 2)
+    {
+        double get_ns = run(threads, lookups, names, [](const std::string &name) { return spdlog::get(name) != nullptr; });
+        double locked_ns = run(threads, lookups, names, [&](const std::string &name) { return locked.get(name) != nullptr; });
+        double default_ns = run(threads, lookups, names, [](const std::string &) { return spdlog::default_logger() != nullptr; });
+        std::printf("%7zu | %10.1f %10.1f | %14.1f\n", threads, get_ns, locked_ns, default_ns);
+    }
+    spdlog::shutdown();
+    return 0;
+}
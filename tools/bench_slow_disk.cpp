@@ -0,0 +1,153 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// enqueue latency of an async logger whose file sink writes to a slow disk (POSIX only). the
+// "disk" is a FIFO read back by a thread at a fixed rate, so the backend thread stalls in its
+// writes as it would on a saturated or stalled disk. the producers time each log call and the
+// percentiles are printed for the block and overrun_oldest policies.
+// build it with and without -DSPDLOG_BACKGROUND_FILE_WRITER to compare the file writers.
+//
+// usage: bench_slow_disk [messages_per_thread] [threads] [disk_kb_per_sec]
+// (default 100000 messages, 2 threads and 4096 KB/s)
+//
+// build: c++ -std=c++11 -O2 -I../include bench_slow_disk.cpp -o bench_slow_disk -pthread
+
+#include "spdlog/spdlog.h"
+#include "spdlog/async.h"
+#include "spdlog/sinks/basic_file_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *fifo_name = "bench_slow_disk.fifo";
+
+// reads the FIFO at bytes_per_sec until the writer closes it
+static void slow_disk(size_t bytes_per_sec, std::atomic<size_t> *read_bytes)
+{
+    int fd = ::open(fifo_name, O_RDONLY);
+    if (fd == -1)
+    {
+        std::perror("bench_slow_disk: open fifo");
+        std::exit(1);
+    }
+    std::vector<char> buf(16 * 1024);
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        auto n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0)
+        {
+            break;
+        }
+        total += static_cast<size_t>(n);
+        std::this_thread::sleep_until(start + std::chrono::microseconds(total * 1000000 / bytes_per_sec));
+    }
+    ::close(fd);
+    read_bytes->store(total);
+}
+
+struct bench_result
+{
+    double p50, p99, p999, max; // ns per log call
+    double seconds;             // until the last message reached the disk
+    size_t bytes;
+};
+
+static bench_result run(spdlog::async_overflow_policy policy, size_t messages, size_t threads, size_t bytes_per_sec)
+{
+    std::atomic<size_t> read_bytes{0};
+    std::thread disk(slow_disk, bytes_per_sec, &read_bytes);
+    std::vector<std::vector<uint32_t>> ns(threads, std::vector<uint32_t>(messages));
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto pool = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+        auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(fifo_name);
+        auto logger = std::make_shared<spdlog::async_logger>("slow_disk", sink, pool, policy);
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < threads; t++)
+        {
+            producers.emplace_back([&, t] {
+                auto &times = ns[t];
+                for (size_t i = 0; i < messages; i++)
+                {
+                    auto before = std::chrono::steady_clock::now();
+                    logger->info("message {} of thread {}: some text to make it about a hundred bytes", i, t);
+                    auto after = std::chrono::steady_clock::now();
+                    times[i] = static_cast<uint32_t>(
+                        std::min<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count(), UINT32_MAX));
+                }
+            });
+        }
+        for (auto &p : producers)
+        {
+            p.join();
+        }
+        // the pool drains the queue before its threads exit, then the sink closes the FIFO
+        logger.reset();
+        pool.reset();
+    }
+    disk.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<uint32_t> all;
+    all.reserve(messages * threads);
+    for (auto &times : ns)
+    {
+        all.insert(all.end(), times.begin(), times.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto at = [&all](double q) { return static_cast<double>(all[static_cast<size_t>(q * (all.size() - 1))]); };
+    return bench_result{at(0.5), at(0.99), at(0.999), static_cast<double>(all.back()), elapsed.count(), read_bytes.load()};
+}
+
+int main(int argc, char *argv[])
+{
+    size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2;
+    size_t kb_per_sec = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 4096;
+    if (messages == 0 || threads == 0 || kb_per_sec == 0)
+    {
+        std::fprintf(stderr, "usage: bench_slow_disk [messages_per_thread] [threads] [disk_kb_per_sec]\n");
+        return 1;
+    }
+
+    ::unlink(fifo_name);
+    if (::mkfifo(fifo_name, 0600) != 0)
+    {
+        std::perror("bench_slow_disk: mkfifo");
+        return 1;
+    }
+
+#ifdef SPDLOG_BACKGROUND_FILE_WRITER
+    const char *writer = "background_file_writer";
+#else
+    const char *writer = "fwrite";
+#endif
+    std::printf("%zu messages x %zu threads, disk at %zu KB/s, %s (ns per log call)\n\n", messages, threads, kb_per_sec, writer);
+    std::printf("%14s | %10s %10s %10s %12s | %9s %9s\n", "policy", "p50", "p99", "p99.9", "max", "seconds", "MB");
+
+    const spdlog::async_overflow_policy policies[] = {spdlog::async_overflow_policy::block, spdlog::async_overflow_policy::overrun_oldest};
+    const char *names[] = {"block", "overrun_oldest"};
+    for (size_t i = 0; i < 2; i++)
+    {
+        auto r = run(policies[i], messages, threads, kb_per_sec * 1024);
+        std::printf("%14s | %10.0f %10.0f %10.0f %12.0f | %9.2f %9.1f\n", names[i], r.p50, r.p99, r.p999, r.max, r.seconds,
+            r.bytes / (1024.0 * 1024.0));
+    }
+    ::unlink(fifo_name);
+    return 0;
+}
@@ -0,0 +1,93 @@
+//
+// Copyright(c) 2018 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// decode the files written by spdlog::sinks::binary_file_sink back to text, using the
+// pattern_formatter layout.
+//
+// usage: binary_log_decoder [-p pattern] [--utc] file...
+// (default pattern "%+", the default pattern of the sinks)
+//
+// build: c++ -std=c++11 -I../include binary_log_decoder.cpp -o binary_log_decoder
+
+#include "spdlog/spdlog.h"
+#include "spdlog/details/binary_log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static int decode_file(const char *filename, spdlog::pattern_formatter &formatter)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+    {
+        std::fprintf(stderr, "binary_log_decoder: cannot open %s\n", filename);
+        return 1;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    spdlog::details::binary_log::decoder decoder(data.data(), data.size());
+    spdlog::details::binary_log::decoded_msg decoded;
+    fmt::memory_buffer formatted;
+    try
+    {
+        while (decoder.next(decoded))
+        {
+            spdlog::details::log_msg msg(decoded.logger_name, decoded.level, spdlog::string_view_t(decoded.text.data(), decoded.text.size()));
+            msg.time = decoded.time;
+            msg.thread_id = decoded.thread_id;
+
+            formatted.resize(0);
+            formatter.format(msg, formatted);
+            std::fwrite(formatted.data(), 1, formatted.size(), stdout);
+        }
+    }
+    // spdlog_ex on corrupt data, also fmt::format_error (corrupt format string) or bad_alloc
+    catch (const std::exception &ex)
+    {
+        std::fprintf(stderr, "binary_log_decoder: %s: %s\n", filename, ex.what());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string pattern = "%+";
+    auto time_type = spdlog::pattern_time_type::local;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            pattern = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--utc") == 0)
+        {
+            time_type = spdlog::pattern_time_type::utc;
+        }
+        else
+        {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty())
+    {
+        std::fprintf(stderr, "usage: binary_log_decoder [-p pattern] [--utc] file...\n");
+        return 2;
+    }
+
+    spdlog::pattern_formatter formatter(pattern, time_type);
+    int result = 0;
+    for (auto *f : files)
+    {
+        result |= decode_file(f, formatter);
+    }
+    return result;
+}
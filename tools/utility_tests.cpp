@@ -0,0 +1,288 @@
+//
+// tests of the logging headers that need a program of their own: the allocation counting of
+// testasyncalloc replaces the global operator new, which must not end up in the library.
+//
+// usage: utility_tests (exit code 1 if a test failed)
+//
+// build: c++ -std=c++11 -O2 -I../include utility_tests.cpp -o utility_tests -pthread
+// (add -DSPDLOG_USE_ZLIB -lz for the gzip rotation test, and build it again with
+// -DSPDLOG_LOCKFREE_QUEUE and -DSPDLOG_PER_THREAD_QUEUE for the other thread pool queues, and
+// with -DNOLOG or -DDLOG_ACTIVE_LEVEL=DLOG_LEVEL_WARN for the level stripping)
+
+#include "DLogger.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/async.h"
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/sinks/rotating_file_sink.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <string>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+// the replaced operators below pair malloc with free, which gcc takes for a mismatch
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// allocations of the calling thread (see testasyncalloc)
+static thread_local size_t thread_allocs = 0;
+
+static void *counted_alloc(size_t size) {
+	thread_allocs++;
+	return std::malloc(size != 0 ? size : 1);
+}
+
+void *operator new(size_t size) {
+	if (void *p = counted_alloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+	if (void *p = counted_alloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	return counted_alloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return counted_alloc(size);
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+#if defined(__cpp_sized_deallocation) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+void operator delete(void *p, size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	std::free(p);
+}
+#endif
+
+// the DLOG_* calls disabled at compile time (DLOG_ACTIVE_LEVEL, NOLOG) or at run time must not
+// evaluate their arguments (so no message is built, nothing allocated)
+// build with e.g. -DDLOG_ACTIVE_LEVEL=DLOG_LEVEL_WARN, or -DNOLOG
+void testlogstrip() {
+	DLog log;
+	log.init("strip");
+	int evaluated = 0;
+	auto arg = [&evaluated]() { return std::string("built ") + std::to_string(++evaluated); };
+	DLOG_DEBUG(log, "debug {}", arg());
+	DLOG_INFO(log, "info {}", arg());
+	DLOG_WARN(log, "warn {}", arg());
+	DLOG_ERROR(log, "error {}", arg());
+	DLOG_CRITICAL(log, "critical {}", arg());
+	DLOG_RATE_LIMITED(log, spdlog::level::debug, 10, 10, arg());
+	DLOG_SAMPLED(log, spdlog::level::debug, 1, arg());
+
+	int enabled = 0;
+	const spdlog::level::level_enum levels[] = { spdlog::level::debug, spdlog::level::info, spdlog::level::warn, spdlog::level::err, spdlog::level::critical };
+	for (auto level : levels) {
+		if (level >= DLOG_ACTIVE_LEVEL && log.should_log(level))
+			enabled++;
+	}
+	if (spdlog::level::debug >= DLOG_ACTIVE_LEVEL && log.should_log(spdlog::level::debug))
+		enabled += 2;
+	CHECK(evaluated == enabled);
+	spdlog::drop("strip");
+}
+
+// the async loggers must not allocate on the logging thread once attached to their pool, whatever
+// the payload length (inline in the queued message, or in a block of the pool's slab)
+void testasyncalloc() {
+	auto pool = std::make_shared<spdlog::details::thread_pool>(1024, 1);
+	auto logger = std::make_shared<spdlog::async_logger>("alloc", std::make_shared<spdlog::sinks::null_sink_mt>(), pool);
+	std::string long_text(300, 'x');
+	logger->info("warm up {}", long_text);
+	size_t before = thread_allocs;
+	for (int i = 0; i < 10000; i++) {
+		logger->info("short message {}", i);
+		logger->info("long message {} {}", i, long_text);
+	}
+	CHECK(thread_allocs == before);
+}
+
+static std::string make_test_dir(const char *prefix) {
+	std::string dir = prefix + std::to_string(std::time(nullptr));
+#ifdef _WIN32
+	CreateDirectoryA(dir.c_str(), nullptr);
+#else
+	mkdir(dir.c_str(), 0755);
+#endif
+	return dir;
+}
+
+static void remove_test_dir(const std::string &dir) {
+#ifdef _WIN32
+	RemoveDirectoryA(dir.c_str());
+#else
+	rmdir(dir.c_str());
+#endif
+}
+
+// the content of a rotated file (gzipped or not)
+static std::string read_rotated(const std::string &base, size_t index) {
+	std::string rotated = spdlog::sinks::rotating_file_sink_mt::calc_filename(base, index);
+	std::string read;
+#ifdef SPDLOG_USE_ZLIB
+	gzFile in = gzopen(spdlog::details::gzip_filename(rotated).c_str(), "rb");
+	if (in == nullptr)
+		in = gzopen(rotated.c_str(), "rb");
+	if (in == nullptr)
+		return read;
+	char buf[4096];
+	int n;
+	while ((n = gzread(in, buf, sizeof(buf))) > 0)
+		read.append(buf, n);
+	gzclose(in);
+#else
+	std::ifstream in(rotated, std::ios::binary);
+	read.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+#endif
+	return read;
+}
+
+static void remove_rotated(const std::string &base, size_t index) {
+	std::string rotated = spdlog::sinks::rotating_file_sink_mt::calc_filename(base, index);
+	std::remove(rotated.c_str());
+#ifdef SPDLOG_USE_ZLIB
+	std::remove(spdlog::details::gzip_filename(rotated).c_str());
+#endif
+}
+
+// the files rotated by the former layout (log.1.txt the newest) are renumbered on the first
+// start (log.<i>.txt -> log.<2n+1-i>.txt), so that the highest index is the newest
+void testrotationmigration() {
+	std::string dir = make_test_dir("rotation_migration_test_");
+	std::string base = dir + "/log.txt";
+	std::time_t now = std::time(nullptr);
+	for (size_t i = 1; i <= 3; i++) {
+		std::string rotated = spdlog::sinks::rotating_file_sink_mt::calc_filename(base, i);
+		std::ofstream(rotated) << "rotated " << i;
+		struct utimbuf times;
+		times.actime = times.modtime = now - static_cast<std::time_t>(i) * 60;
+		utime(rotated.c_str(), &times);
+	}
+	{
+		spdlog::sinks::rotating_file_sink_mt sink(base, 1000, 3);
+	}
+	CHECK(read_rotated(base, 6) == "rotated 1");
+	CHECK(read_rotated(base, 5) == "rotated 2");
+	CHECK(read_rotated(base, 4) == "rotated 3");
+	CHECK(!std::ifstream(spdlog::sinks::rotating_file_sink_mt::calc_filename(base, 1)).good());
+
+	// started again, the renumbered files are left as they are
+	{
+		spdlog::sinks::rotating_file_sink_mt sink(base, 1000, 3);
+	}
+	CHECK(read_rotated(base, 6) == "rotated 1");
+	CHECK(read_rotated(base, 4) == "rotated 3");
+
+	for (size_t i = 4; i <= 6; i++)
+		remove_rotated(base, i);
+	std::remove(base.c_str());
+	remove_test_dir(dir);
+}
+
+#ifdef SPDLOG_USE_ZLIB
+// the rotated files are gzipped by the sink's background worker. once the sink is destroyed (it
+// waits for the worker), each rotated file must be a complete .gz in place of the original, and
+// the .gz files and the current file read back must give all the messages, in order
+void testgziprotation() {
+	std::string dir = make_test_dir("gzip_rotation_test_");
+	std::string base = dir + "/log.txt";
+	std::string expected;
+	{
+		auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(base, 1000, 100);
+		sink->set_pattern("%v");
+		spdlog::logger logger("gzip", sink);
+		for (int i = 0; i < 100; i++) {
+			std::string line = fmt::format("line {:04d} {}", i, std::string(40, 'a' + i % 26));
+			logger.info(line);
+			expected += line + spdlog::details::os::default_eol;
+		}
+	}
+
+	std::string read;
+	size_t index = 1;
+	for (;; index++) {
+		std::string rotated = spdlog::sinks::rotating_file_sink_mt::calc_filename(base, index);
+		std::string gz = spdlog::details::gzip_filename(rotated);
+		gzFile in = gzopen(gz.c_str(), "rb");
+		if (in == nullptr)
+			break;
+		char buf[4096];
+		int n;
+		while ((n = gzread(in, buf, sizeof(buf))) > 0)
+			read.append(buf, n);
+		CHECK(n == 0);
+		gzclose(in);
+		CHECK(!std::ifstream(rotated).good());
+		std::remove(gz.c_str());
+	}
+	CHECK(index > 2);
+	std::ifstream current(base, std::ios::binary);
+	read.append(std::istreambuf_iterator<char>(current), std::istreambuf_iterator<char>());
+	current.close();
+	std::remove(base.c_str());
+	remove_test_dir(dir);
+	CHECK(read == expected);
+}
+#endif
+
+int main() {
+	testlogstrip();
+	testasyncalloc();
+	testrotationmigration();
+#ifdef SPDLOG_USE_ZLIB
+	testgziprotation();
+#endif
+	spdlog::shutdown();
+	if (failures != 0) {
+		std::fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("all tests passed\n");
+	return 0;
+}